@@ -0,0 +1,304 @@
+// bench/bench.cpp
+//
+// Self-contained benchmark harness: parse, deriv and simplify time, node
+// counts of f, f', f'' and per-point evaluation time of every engine, for
+// a fixed corpus plus seeded random expressions of increasing depth.
+// Heap allocations per front-end call are counted through a replaced
+// global operator new.
+// Results go to stdout (or the file given as argument) as JSON.
+//
+//   make bench && ./bench/bench [--quick] [out.json]
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <new>
+
+#include "ast.hpp"
+#include "differentiator.hpp"
+#include "parser.hpp"
+#include "simplify.hpp"
+#include "expression.hpp"
+#include "functions.hpp"
+#include "simd.hpp"
+
+
+
+// Every allocation of the process goes through here
+std::atomic<unsigned long long> allocations{ 0 };
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if ( void *p = std::malloc(size ? size : 1) ) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+
+
+namespace {
+
+// The test expressions and points from main.cpp
+const std::vector<std::string> corpus = {
+    "2 * x^3",
+    "sin(x)",
+    "x^2 + 3*x",
+    "log(x)",
+    "x^x",
+    "x^2 * cos(x) + log(x) * cos(x - 1)",
+    "22.5+log(sin(77.6)^(50.2^42.1)/(x/x)-(81.9/x^x*58.8)*(18*57.2^x-x^x+81.9*x^5.2*x^62)^x)",
+    "x^93.2 - x*cos( x^(x^x / x^28.8 / x) + x - x^60.3 * 0.5^x / cos(48.6^x + 24.9^80.3 / 60 - x*15.9))*44.4",
+    "x^88.3 / x^81.8 / x",
+    "x+cot(89.4*x^(x/62.5^x*36.5^52.5-63/x^37+27.3)+x/x)+99.5/x/(x+x^69.1*(8.4^x*x^37.6/x)/x^sin(57.7^x*x^x+x-x))^x"
+};
+
+const std::vector<Complex> points = {
+    { 2, 2 }, { 1.63, -2.11 }, { 1, 0 }, { -32, 32 }, { -4.6, -9.47 }, { 5.89, 6.23 }, { -9.17, 2.23 }, { -1.73, 3 }
+};
+
+const int randomDepths[] = { 2, 4, 6, 8 };
+const int randomPerDepth = 2;
+const std::uint32_t randomSeed = 20240601;
+
+const size_t batchPoints = 1024;
+
+double minSeconds = 0.2;    // Each measurement is repeated until it took at least this long
+
+
+// Random expression of the given depth over the whole grammar. Exponents
+// are small constants, so the values stay in range at the test points.
+std::string randomExpression(std::mt19937 &rng, int depth) {
+    auto pick = [&](int n) { return static_cast<int>(rng() % static_cast<std::uint32_t>(n)); };
+
+    if ( depth <= 0 ) {
+        if ( pick(3) > 0 ) {
+            return "x";
+        }
+        return std::to_string(1 + pick(9)) + "." + std::to_string(pick(10));
+    }
+
+    switch (pick(6)) {
+        case 0:  return randomExpression(rng, depth - 1) + "+" + randomExpression(rng, depth - 1);
+        case 1:  return randomExpression(rng, depth - 1) + "-" + randomExpression(rng, depth - 1);
+        case 2:  return "(" + randomExpression(rng, depth - 1) + ")*(" + randomExpression(rng, depth - 1) + ")";
+        case 3:  return "(" + randomExpression(rng, depth - 1) + ")/(" + randomExpression(rng, depth - 1) + "+2)";
+        case 4:  return "(" + randomExpression(rng, depth - 1) + ")^" + std::to_string(2 + pick(3));
+        default: return std::string(funcInfo(static_cast<FuncId>(pick(5))).name) + "(" + randomExpression(rng, depth - 1) + ")";
+    }
+}
+
+
+volatile long double sink;
+
+// Average wall time of one call to body, in nanoseconds
+template <typename Body>
+double nsPerCall(Body &&body) {
+    using Clock = std::chrono::steady_clock;
+
+    for ( size_t reps = 1; ; reps *= 2 ) {
+        auto start = Clock::now();
+        for ( size_t i = 0; i < reps; ++i ) {
+            body();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if ( seconds >= minSeconds || reps >= (size_t(1) << 30) ) {
+            return seconds * 1e9 / static_cast<double>(reps);
+        }
+    }
+}
+
+
+// Heap allocations made by one call to body, after a first call has
+// warmed up the per-thread scratch buffers
+template <typename Body>
+unsigned long long allocationsPerCall(Body &&body) {
+    body();
+
+    unsigned long long before = allocations.load(std::memory_order_relaxed);
+    body();
+    return allocations.load(std::memory_order_relaxed) - before;
+}
+
+
+std::string jsonString(const std::string &text) {
+    std::string out = "\"";
+    for ( char c : text ) {
+        if ( c == '"' || c == '\\' )  out += '\\';
+        out += c;
+    }
+
+    return out + "\"";
+}
+
+std::string jsonNumber(double value) {
+    if ( !std::isfinite(value) ) {
+        return "null";
+    }
+
+    std::ostringstream out;
+    out.precision(6);
+    out << value;
+    return out.str();
+}
+
+
+// One corpus entry as a JSON object
+std::string measure(const std::string &mathExpr, const std::string &kind) {
+    std::ostringstream out;
+    out << "    {\n      \"expression\": " << jsonString(mathExpr) << ",\n      \"kind\": " << jsonString(kind) << ",\n";
+
+    // Front end: parse, then one deriv + simplify step per order
+    NodePtr raw = Parser(mathExpr).parse();
+    NodePtr trees[3] = { simplify(raw) };
+    trees[1] = simplify(trees[0] -> deriv());
+    trees[2] = simplify(trees[1] -> deriv());
+
+    double parseNs = nsPerCall([&] { Parser(mathExpr).parse(); });
+    double derivNs[2], simplifyNs[2];
+    for ( int order = 1; order <= 2; ++order ) {
+        NodePtr derived = trees[order - 1] -> deriv();
+        derivNs[order - 1] = nsPerCall([&] { trees[order - 1] -> deriv(); });
+        simplifyNs[order - 1] = nsPerCall([&] { simplify(derived); });
+    }
+    double buildNs = nsPerCall([&] { Expression e(mathExpr); e.tape(2); });
+
+    unsigned long long parseAllocs = allocationsPerCall([&] { Parser(mathExpr).parse(); });
+    unsigned long long derivAllocs[2] = {
+        allocationsPerCall([&] { trees[0] -> deriv(); }),
+        allocationsPerCall([&] { trees[1] -> deriv(); })
+    };
+    // differentiate() and a call of f'', which builds all three orders
+    unsigned long long differentiateAllocs = allocationsPerCall([&] { sink = std::get<2>(differentiate(mathExpr))(points[0]).real(); });
+
+    SimplifyReport report;
+    DiffOptions reportOptions;
+    reportOptions.report = &report;
+    Expression counted(mathExpr, reportOptions);
+
+    out << "      \"parse_ns\": " << jsonNumber(parseNs) << ",\n"
+        << "      \"deriv_ns\": [" << jsonNumber(derivNs[0]) << ", " << jsonNumber(derivNs[1]) << "],\n"
+        << "      \"simplify_ns\": [" << jsonNumber(simplifyNs[0]) << ", " << jsonNumber(simplifyNs[1]) << "],\n"
+        << "      \"build_ns\": " << jsonNumber(buildNs) << ",\n"
+        << "      \"allocations\": { \"parse\": " << parseAllocs << ", \"deriv\": [" << derivAllocs[0] << ", " << derivAllocs[1]
+        << "], \"differentiate\": " << differentiateAllocs << " },\n"
+        << "      \"nodes_raw\": [" << report.nodesBefore[0] << ", " << report.nodesBefore[1] << ", " << report.nodesBefore[2] << "],\n"
+        << "      \"nodes\": [" << report.nodesAfter[0] << ", " << report.nodesAfter[1] << ", " << report.nodesAfter[2] << "],\n"
+        << "      \"tape_size\": [" << counted.tape(0).size() << ", " << counted.tape(1).size() << ", " << counted.tape(2).size() << "],\n";
+
+    // Per-point evaluation, cycling through the test points
+    DiffOptions tapeOptions, sharedOptions, jetOptions;
+    tapeOptions.useTape = true;
+    sharedOptions.shareSubexpressions = true;
+    jetOptions.engine = Engine::Jet;
+
+    Expression tree(mathExpr), tape(mathExpr, tapeOptions), shared(mathExpr, sharedOptions), jet(mathExpr, jetOptions);
+    size_t next = 0;
+    auto point = [&] { next = (next + 1) % points.size(); return points[next]; };
+
+    auto perOrder = [&](const Expression &e) {
+        std::ostringstream row;
+        row << "[";
+        for ( int order = 0; order <= 2; ++order ) {
+            row << ( order ? ", " : "" ) << jsonNumber(nsPerCall([&] { sink = e.eval(order, point()).real(); }));
+        }
+        row << "]";
+        return row.str();
+    };
+
+    std::vector<Complex> in(batchPoints), result(batchPoints);
+    std::vector<double> inRe(batchPoints), inIm(batchPoints), outRe(batchPoints), outIm(batchPoints);
+    for ( size_t i = 0; i < batchPoints; ++i ) {
+        in[i] = points[i % points.size()] * Complex(1.0 + 1e-3 * static_cast<double>(i));
+        inRe[i] = static_cast<double>(in[i].real());
+        inIm[i] = static_cast<double>(in[i].imag());
+    }
+
+    out << "      \"eval_ns\": {\n"
+        << "        \"tree\": " << perOrder(tree) << ",\n"
+        << "        \"tape\": " << perOrder(tape) << ",\n"
+        << "        \"shared\": " << perOrder(shared) << ",\n"
+        << "        \"fused_all\": " << jsonNumber(nsPerCall([&] { sink = shared.evalAll(point()).f2.real(); })) << ",\n"
+        << "        \"jet_all\": " << jsonNumber(nsPerCall([&] { sink = jet.evalAll(point()).f2.real(); })) << ",\n"
+        << "        \"batch\": [";
+    for ( int order = 0; order <= 2; ++order ) {
+        double ns = nsPerCall([&] { tape.evalBatch(order, in.data(), result.data(), batchPoints); });
+        out << ( order ? ", " : "" ) << jsonNumber(ns / batchPoints);
+    }
+    out << "],\n        \"batch_soa\": [";
+    for ( int order = 0; order <= 2; ++order ) {
+        double ns = nsPerCall([&] { tape.evalBatchSoA(order, inRe.data(), inIm.data(), outRe.data(), outIm.data(), batchPoints); });
+        out << ( order ? ", " : "" ) << jsonNumber(ns / batchPoints);
+    }
+    out << "]\n      }\n    }";
+
+    return out.str();
+}
+
+} // namespace
+
+
+
+int main(int argc, char *argv[]) {
+    std::string outPath;
+    for ( int i = 1; i < argc; ++i ) {
+        std::string arg = argv[i];
+        if ( arg == "--quick" ) {
+            minSeconds = 0.01;
+        }
+        else {
+            outPath = arg;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    for ( const std::string &mathExpr : corpus ) {
+        entries.emplace_back(mathExpr, "corpus");
+    }
+
+    std::mt19937 rng(randomSeed);
+    for ( int depth : randomDepths ) {
+        for ( int i = 0; i < randomPerDepth; ++i ) {
+            entries.emplace_back(randomExpression(rng, depth), "random-depth-" + std::to_string(depth));
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"compiler\": " << jsonString(__VERSION__) << ",\n"
+         << "  \"simd\": " << jsonString(simd::isa()) << ",\n"
+         << "  \"min_seconds\": " << minSeconds << ",\n"
+         << "  \"batch_points\": " << batchPoints << ",\n"
+         << "  \"results\": [\n";
+
+    for ( size_t i = 0; i < entries.size(); ++i ) {
+        std::cerr << "[" << (i + 1) << "/" << entries.size() << "] " << entries[i].first.substr(0, 60) << std::endl;
+        json << measure(entries[i].first, entries[i].second) << ( i + 1 < entries.size() ? ",\n" : "\n" );
+    }
+    json << "  ]\n}\n";
+
+    if ( outPath.empty() ) {
+        std::cout << json.str();
+    }
+    else {
+        std::ofstream(outPath) << json.str();
+    }
+
+    return 0;
+}
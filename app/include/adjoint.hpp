@@ -0,0 +1,55 @@
+#ifndef ADJOINT_HPP
+#define ADJOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "tape.hpp"
+
+
+
+/**
+ * @brief Reverse-mode (adjoint) gradient over a compiled tape.
+ *
+ * gradient() runs the tape forward once, keeping the value of every
+ * instruction, then walks it backwards once, accumulating the adjoint
+ * d f / d value of each instruction from those of its users. The whole
+ * gradient costs a small constant multiple of one evaluation, for any
+ * number of variables, and no derivative tree is built.
+ *
+ * The tape's register slots are resolved into one value per instruction
+ * at construction, and the value and adjoint buffers are allocated there
+ * as well, so repeated gradient() calls never allocate. The buffers make
+ * an AdjointTape single-threaded: use one per thread. The Tape itself is
+ * copied and need not outlive it.
+ */
+class AdjointTape {
+public:
+    // Gradient of the given output of tape
+    explicit AdjointTape(const Tape &tape, size_t output = 0);
+
+    // f and grad[i] = df/dvar_i at vars, for i < variableCount()
+    Complex gradient(const Complex *vars, Complex *grad);
+
+    size_t variableCount() const { return variables; }
+    size_t size() const { return code.size(); }
+
+    // Heap bytes of the instructions and of the value and adjoint buffers
+    size_t memoryBytes() const;
+
+private:
+    std::vector<Instruction> code;      // dst is the instruction's index; a, b are value ids
+    std::vector<Complex> constants;
+    std::vector<char> varying;          // The value depends on a variable
+    std::uint32_t result = 0;           // Value id of the output
+    size_t variables = 0;
+
+    std::vector<Complex> values;        // Forward value of every instruction
+    std::vector<Complex> adjoints;      // d f / d values[i]
+};
+
+
+
+#endif // ADJOINT_HPP
@@ -0,0 +1,83 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+
+
+/**
+ * @brief Bump allocator that owns every node built while it is active.
+ *
+ * Nodes are placed back to back in large blocks and destroyed all at
+ * once with the arena. NodePtrs to arena nodes are non-owning aliases
+ * without a control block, so copying them costs no refcount traffic;
+ * they are valid exactly as long as the arena is.
+ */
+class NodeArena {
+public:
+    NodeArena() = default;
+    ~NodeArena();
+
+    NodeArena(const NodeArena &) = delete;
+    NodeArena &operator=(const NodeArena &) = delete;
+
+    // Raw storage for one object
+    void *allocate(size_t size, size_t align);
+
+    // Register a node constructed in allocate()d storage for destruction with the arena
+    void adopt(Node *node) { nodes.push_back(node); }
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t bytesReserved() const { return blocks.size() * blockBytes; }
+
+    static constexpr size_t blockBytes = 64 * 1024;
+
+private:
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    std::vector<Node *> nodes;
+    size_t used = blockBytes;   // Bytes taken in the last block (full: no block yet)
+};
+
+
+// Makes `arena` the target of makeNode() on the current thread while in scope
+class ArenaScope {
+public:
+    explicit ArenaScope(NodeArena &arena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    NodeArena *previous;
+};
+
+
+// Arena of the innermost ArenaScope on this thread, or nullptr
+NodeArena *currentArena();
+
+
+// Create a node: inside an ArenaScope it is placed in that arena,
+// otherwise it is an ordinary shared_ptr
+template <typename T, typename... Args>
+NodePtr makeNode(Args &&...args) {
+    NodeArena *arena = currentArena();
+    if ( !arena ) {
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
+    T *node = new (arena -> allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    arena -> adopt(node);
+
+    return NodePtr(NodePtr(), node);
+}
+
+
+
+#endif // ARENA_HPP
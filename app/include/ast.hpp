@@ -2,8 +2,9 @@
 #define AST_HPP
 
 #include <complex>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <string>
 #include <vector>
 
 
@@ -16,28 +17,53 @@ using NodePtr = std::shared_ptr<Node>;
 
 
 struct Node {
+    // Concrete node type, so the traversals below dispatch without virtual calls
+    enum class Kind : std::uint8_t { Const, Var, Binary, Power, IntPower, Func, Poly };
+
+    const Kind kind;
+
+    // No variable below this node: the whole subtree evaluates to one
+    // value and its derivatives are zero. Set once, from the operands' flags.
+    const bool constant;
+
+    Node(Kind k, bool c) : kind(k), constant(c) {}
     virtual ~Node() = default;
 
-    virtual Complex eval(const Complex &x) const = 0;
+    // Evaluate with vars[i] bound to the variable with index i (see
+    // SymbolTable). Walks the tree with an explicit stack, so the depth
+    // is limited by memory rather than by the thread's call stack.
+    Complex eval(const Complex *vars) const;
+
+    // Evaluate a tree in x alone at x
+    Complex eval(const Complex &x) const { return eval(&x); }
 
-    virtual NodePtr deriv() const = 0;
+    // Partial derivative by the variable with index var, built without
+    // recursion; a subtree shared by pointer gets one derivative, shared
+    // the same way. deriv() is d/dx.
+    NodePtr deriv(std::uint32_t var) const;
+    NodePtr deriv() const { return deriv(0); }
 };
 
 
-// <constant>  ::= [0-9]+ ( "." [0-9]+ )?
+// <constant>  ::= [0-9]+ ( "." [0-9]+ )?, or a folded x-independent subtree
 struct ConstNode : Node {
-    long double value;  // store real part, Im = 0
+    Complex value;
 
-    explicit ConstNode(long double v);
-    Complex eval(const Complex &x) const override;
-    NodePtr deriv() const override;
+    explicit ConstNode(const Complex &v);
+    Complex apply() const;
+    NodePtr derivFrom() const;
 };
 
 
-// <variable>  ::= "x"
+// <variable>  ::= "x", or any name in a SymbolTable
 struct VarNode : Node {
-    Complex eval(const Complex &x) const override;
-    NodePtr deriv() const override;
+    std::uint32_t index;    // Position in the variable vector; x alone is 0
+
+    explicit VarNode(std::uint32_t i = 0);
+    Complex apply(const Complex *vars) const;
+
+    // 1 for the variable differentiated by, 0 for any other
+    NodePtr derivFrom(std::uint32_t var) const;
 };
 
 
@@ -48,8 +74,13 @@ struct BinaryNode : Node {
     NodePtr right;  // right operand
 
     BinaryNode(char o, NodePtr l, NodePtr r);
-    Complex eval(const Complex &x) const override;
-    NodePtr deriv() const override;
+    ~BinaryNode() override;
+
+    // Apply op to the operand values
+    Complex apply(const Complex &a, const Complex &b) const;
+
+    // Derivative from the operand derivatives dl, dr
+    NodePtr derivFrom(const NodePtr &dl, const NodePtr &dr) const;
 };
 
 
@@ -60,32 +91,238 @@ struct PowerNode : Node {
 
     // b^e
     PowerNode(NodePtr b, NodePtr e);
+    ~PowerNode() override;
     
-    // Evaluate u(x)^v(x)
-    Complex eval(const Complex &x) const override;
+    // Evaluate u^v from the values of u and v
+    Complex apply(const Complex &u, const Complex &v) const;
 
-    // Derivative: d(u^v) = u^v * [v'*ln(u) + v*(u'/u)]
-    NodePtr deriv() const override;
+    // Derivative: d(u^v) = u^v * [v'*ln(u) + v*(u'/u)], or the power rule
+    // v * u^(v-1) * u' when v is constant
+    NodePtr derivFrom(const NodePtr &du, const NodePtr &dv) const;
 };
 
 
-// Function calls (sin, cos, tan, cot, log)
+// base^n for a constant integer n, evaluated by repeated squaring
+struct IntPowerNode : Node {
+    NodePtr base;       // Base function u(x)
+    std::int32_t n;     // Exponent
+
+    // Largest |n| makePower() gives an IntPowerNode; the power rule steps
+    // the exponent down by one per order, so n - 1, n - 2, ... stay int32
+    static constexpr std::int32_t maxExponent = 1 << 30;
+
+    IntPowerNode(NodePtr b, std::int32_t e);
+    ~IntPowerNode() override;
+
+    // u^n, see powInt()
+    Complex apply(const Complex &u) const;
+
+    // Power rule: d(u^n) = n * u^(n-1) * u'
+    NodePtr derivFrom(const NodePtr &du) const;
+};
+
+
+// Unary functions, resolved from their name once at parse time.
+// Names, derivatives and jets live in the registry (functions.hpp).
+enum class FuncId : std::uint8_t {
+    Sin, Cos, Tan, Cot, Log,
+    Exp, Sqrt, Sinh, Cosh, Tanh, Asin, Acos, Atan
+};
+
+
+// Function calls (sin, cos, tan, cot, log, exp, sqrt, ...)
 struct FuncNode : Node {
-    std::string name;
-    std::vector<NodePtr> args;  // single argument (args[0])
+    FuncId func;
+    NodePtr arg;
 
-    // name(arg)
-    FuncNode(std::string nm, std::vector<NodePtr> arg);
+    // func(arg)
+    FuncNode(FuncId f, NodePtr a);
+    ~FuncNode() override;
 
-    // Evaluation by function
-    // <func_name> ::= "sin" | "cos" | "tan" | "cot" | "log"
-    Complex eval(const Complex &x) const override;
+    // Evaluation by function, see applyFunc()
+    Complex apply(const Complex &a) const;
 
     // Compute derivative via chain rule: f'(g) = f'_outer * g'
     // (f∘inner)' = f'_outer(inner) * inner'
-    NodePtr deriv() const override;
+    NodePtr derivFrom(const NodePtr &darg) const;
+};
+
+
+// Polynomial c[0] + c[1] u + ... + c[n] u^n in its argument, evaluated by
+// Horner's rule (see horner()). Built by collectPolynomials() (poly.hpp).
+struct PolyNode : Node {
+    NodePtr arg;
+    std::vector<Complex> coeffs;    // Lowest degree first, at least one
+
+    PolyNode(NodePtr a, std::vector<Complex> c);
+    ~PolyNode() override;
+
+    size_t degree() const { return coeffs.size() - 1; }
+
+    Complex apply(const Complex &u) const;
+
+    // Chain rule on the coefficients: p'(u) * u', with p' again a PolyNode
+    NodePtr derivFrom(const NodePtr &darg) const;
+};
+
+
+
+// Operands of node in evaluation order; returns their count (0 to 2)
+inline size_t operands(const Node &node, const NodePtr *out[2]) {
+    switch (node.kind) {
+        case Node::Kind::Binary: {
+            auto &binary = static_cast<const BinaryNode &>(node);
+            out[0] = &binary.left;
+            out[1] = &binary.right;
+            return 2;
+        }
+        case Node::Kind::Power: {
+            auto &power = static_cast<const PowerNode &>(node);
+            out[0] = &power.base;
+            out[1] = &power.exp;
+            return 2;
+        }
+        case Node::Kind::IntPower:
+            out[0] = &static_cast<const IntPowerNode &>(node).base;
+            return 1;
+        case Node::Kind::Func:
+            out[0] = &static_cast<const FuncNode &>(node).arg;
+            return 1;
+        case Node::Kind::Poly:
+            out[0] = &static_cast<const PolyNode &>(node).arg;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+
+// base^exp for a new tree: a constant integer exponent up to
+// IntPowerNode::maxExponent gives an IntPowerNode, exponent 0.5 a sqrt()
+// call, anything else a PowerNode
+NodePtr makePower(NodePtr base, NodePtr exp);
+
+
+// node itself, or a ConstNode with its value if node is a constant
+// subtree other than a single ConstNode
+NodePtr foldConstant(NodePtr node);
+
+
+// Node::deriv() with the derivative of every node kept across calls, so a
+// tree sharing nodes by pointer with earlier ones (e.g. canonical nodes of
+// one NodeFactory) gets only its new nodes differentiated. The trees passed
+// are kept alive, since the memo is keyed by node address.
+class DerivCache {
+public:
+    explicit DerivCache(std::uint32_t var = 0);
+    ~DerivCache();
+
+    DerivCache(const DerivCache &) = delete;
+    DerivCache &operator=(const DerivCache &) = delete;
+
+    NodePtr deriv(const NodePtr &tree);
+
+    // Number of nodes differentiated so far
+    size_t size() const;
+
+private:
+    struct Memo;
+
+    std::unique_ptr<Memo> memo;
+    std::uint32_t var;
 };
 
 
+// u^n by repeated squaring: about 2 log2|n| multiplications instead of
+// exp(n log u). u^0 is 1 and a negative n divides once at the end.
+template <typename T>
+std::complex<T> powInt(const std::complex<T> &u, std::int32_t n) {
+    std::uint32_t k = ( n < 0 ) ? 0u - static_cast<std::uint32_t>(n) : static_cast<std::uint32_t>(n);
+    std::complex<T> result, power = u;
+    bool started = false;   // result holds a product (never multiply by a literal 1)
+
+    while ( k ) {
+        if ( k & 1u ) {
+            result = started ? result * power : power;
+            started = true;
+        }
+        k >>= 1;
+        if ( k ) {
+            power *= power;
+        }
+    }
+
+    if ( !started ) {
+        return std::complex<T>(1);
+    }
+    return ( n < 0 ) ? std::complex<T>(1) / result : result;
+}
+
+
+// c[0] + c[1] u + ... + c[degree] u^degree by Horner's rule, one
+// multiplication and one addition per degree, in the precision of T
+template <typename T>
+std::complex<T> horner(const Complex *c, size_t degree, const std::complex<T> &u) {
+    std::complex<T> result(c[degree]);
+    for ( size_t k = degree; k-- > 0; ) {
+        result = result * u + std::complex<T>(c[k]);
+    }
+
+    return result;
+}
+
+// Coefficients of the derivative of the polynomial c[0..degree]
+inline std::vector<Complex> derivCoeffs(const Complex *c, size_t degree) {
+    if ( degree == 0 ) {
+        return { Complex(0.0) };
+    }
+
+    std::vector<Complex> d(degree);
+    for ( size_t k = 1; k <= degree; ++k ) {
+        d[k - 1] = c[k] * static_cast<long double>(k);
+    }
+    return d;
+}
+
+
+// Calls visit(ptr) on every node reachable from root, operands before the
+// node and left before right, as a recursive walk would, but with an
+// explicit stack. Nodes for which done(node) holds are skipped together
+// with their operands: a memoizing pass makes done() true in visit() and
+// handles each shared node once, a pass whose done() is always false
+// visits shared subtrees once per occurrence.
+template <typename Done, typename Visit>
+void postOrder(const NodePtr &root, Done &&done, Visit &&visit) {
+    struct Frame {
+        const NodePtr *node;
+        bool expanded;      // Operands already pushed
+    };
+    std::vector<Frame> stack;
+    stack.reserve(64);      // One allocation for all but deep trees
+    stack.push_back({ &root, false });
+
+    while ( !stack.empty() ) {
+        Frame frame = stack.back();
+
+        // An expanded node cannot have become done: it is not reachable from its operands
+        if ( frame.expanded ) {
+            stack.pop_back();
+            visit(*frame.node);
+            continue;
+        }
+        if ( done(frame.node -> get()) ) {
+            stack.pop_back();
+            continue;
+        }
+
+        stack.back().expanded = true;
+        const NodePtr *ops[2];
+        for ( size_t n = operands(**frame.node, ops); n > 0; --n ) {
+            stack.push_back({ ops[n - 1], false });
+        }
+    }
+}
+
+
 
 #endif // AST_HPP
\ No newline at end of file
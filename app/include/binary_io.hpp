@@ -0,0 +1,33 @@
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "expression.hpp"
+#include "thread_pool.hpp"
+
+
+
+// Element type of a binary point file
+enum class BinaryFormat {
+    Double,         // 8-byte IEEE double
+    LongDouble      // Native long double (16 bytes on x86-64)
+};
+
+
+/**
+ * @brief Evaluates f, f', f'' over a raw binary file of points.
+ *
+ * The input is an array of interleaved (re, im) pairs. The output file is
+ * written with three pairs per input point, f then f' then f'', in the same
+ * element type. Both files are memory-mapped and processed in chunks on
+ * the pool's threads, so there is no text conversion and inputs larger
+ * than memory work. Returns the number of points.
+ */
+size_t evalBinaryFile(const Expression &expr, const std::string &inPath, const std::string &outPath,
+                      BinaryFormat format, ThreadPool &pool);
+
+
+
+#endif // BINARY_IO_HPP
@@ -0,0 +1,83 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "differentiator.hpp"
+#include "expression.hpp"
+
+
+
+// Counters of an ExpressionCache at one point in time
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;       // Sum of Expression::memoryBytes() over the entries
+};
+
+
+/**
+ * @brief Thread-safe LRU cache of compiled Expressions.
+ *
+ * Entries are keyed by the whitespace-normalized input, so "x^2 + 1" and
+ * "x^2+1" share one Expression; a hit skips parsing, differentiation and
+ * tape compilation. The least recently used entries are evicted once
+ * there are more than `capacity` of them or, if maxBytes is non-zero,
+ * once they hold more than maxBytes. Expressions handed out stay valid
+ * after their eviction. Orders are built lazily after an Expression is
+ * handed out, so an entry's bytes are measured again on a hit once it has
+ * built more.
+ */
+class ExpressionCache {
+public:
+    explicit ExpressionCache(size_t capacity = 1024, size_t maxBytes = 0, const DiffOptions &options = DiffOptions());
+
+    ExpressionCache(const ExpressionCache &) = delete;
+    ExpressionCache &operator=(const ExpressionCache &) = delete;
+
+    // The cached Expression for mathExpr, built on a miss
+    std::shared_ptr<const Expression> get(const std::string &mathExpr);
+
+    // differentiate() through the cache
+    std::tuple<Func, Func, Func> differentiate(const std::string &mathExpr);
+
+    CacheStats stats() const;
+    void clear();
+
+    // Drops whitespace except where it separates two characters of one token
+    static std::string normalize(const std::string &mathExpr);
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const Expression> expr;
+        size_t bytes;
+        size_t builds;      // expr -> buildCount() when bytes was measured
+    };
+
+    const size_t capacity;
+    const size_t maxBytes;
+    const DiffOptions options;
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries;   // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    CacheStats counters;
+
+    void evict();
+
+    // Charge the entry of key, if it still holds expr, for what expr built since it was measured
+    void remeasure(const std::string &key, const std::shared_ptr<const Expression> &expr);
+};
+
+
+
+#endif // CACHE_HPP
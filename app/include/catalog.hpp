@@ -0,0 +1,73 @@
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "expression.hpp"
+#include "mapped_file.hpp"
+#include "tape.hpp"
+
+
+
+/**
+ * @brief A catalog file of compiled expressions, evaluated in place.
+ *
+ * write() parses and differentiates every expression once and stores
+ * the tapes of its f, f', f''; workers then open the file instead of
+ * rebuilding the expressions.
+ * The file is memory-mapped and every tape is handed out as a TapeView
+ * into the mapping, so opening a catalog parses, differentiates and
+ * allocates nothing per node; it only checks that every instruction
+ * stays within its tape's registers, constants and variables, so a
+ * corrupt file cannot make evaluation read out of bounds.
+ *
+ * The layout is the native one of Instruction and Complex. The header
+ * holds a format version and the sizes the file was written with, and
+ * a file of another version or written on an incompatible platform is
+ * rejected.
+ */
+class Catalog {
+public:
+    static constexpr std::uint32_t version = 2;
+
+    explicit Catalog(const std::string &path);
+
+    // Build all expressions with the given options and write them to path
+    static void write(const std::string &path, const std::vector<std::string> &expressions,
+                      const DiffOptions &options = DiffOptions());
+
+    Catalog(const Catalog &) = delete;
+    Catalog &operator=(const Catalog &) = delete;
+
+    size_t size() const { return count; }
+
+    // Whitespace-normalized source of an entry, as in ExpressionCache
+    std::string_view expression(size_t entry) const;
+
+    // Tape of the derivative of the given order (0, 1 or 2) of an entry
+    TapeView tape(size_t entry, int order) const;
+
+    // Entry holding mathExpr (compared after normalization), or nullptr
+    const size_t *find(const std::string &mathExpr) const;
+
+private:
+    struct TapeRecord;
+    struct EntryRecord;
+
+    MappedFile file;
+    const EntryRecord *entries = nullptr;
+    size_t count = 0;
+    std::unordered_map<std::string_view, size_t> index;  // Normalized source -> entry
+
+    const char *bytes() const { return static_cast<const char *>(file.data()); }
+    void validate(const std::string &path) const;
+};
+
+
+
+#endif // CATALOG_HPP
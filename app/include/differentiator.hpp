@@ -3,19 +3,85 @@
 
 
 
+#include <complex>
 #include <functional>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "ast.hpp" // Provides the Complex type definition
+#include "expression.hpp"
 
 
 
-using Func = std::function<Complex(const Complex&)>;
+template <typename T>
+using BasicFunc = std::function<std::complex<T>(const std::complex<T>&)>;
 
+using Func = BasicFunc<long double>;
 
-std::tuple<Func, Func, Func> differentiate(const std::string &mathExpr);
+// Returns f, f', f'' at once (see Jet)
+using FusedFunc = std::function<Jet(const Complex&)>;
 
+// Returns f, f', ..., f^(n) at once
+using SeriesFunc = std::function<std::vector<Complex>(const Complex&)>;
 
+// out[i] = f(in[i]) for i < n
+using BatchFunc = std::function<void(const Complex *in, Complex *out, size_t n)>;
 
-#endif // DIFFERENTIATOR_HPP
\ No newline at end of file
+
+// The order-th derivative of a shared Expression as a plain callable type.
+// Unlike Func it is not type-erased: a call through it can inline into
+// Expression::eval, and copying it only bumps the shared count.
+struct ExpressionFunc {
+    std::shared_ptr<const Expression> expr;
+    int order = 0;
+
+    Complex operator()(const Complex &x) const { return expr -> eval(order, x); }
+};
+
+
+// f, f', f'' as point and batch callables
+struct NativeFuncs {
+    Func f, f1, f2;
+    BatchFunc batch, batch1, batch2;
+    bool native = false;    // Compiled to machine code; false if it fell back to the tree evaluator
+};
+
+
+std::tuple<Func, Func, Func> differentiate(const std::string &mathExpr, const DiffOptions &options = DiffOptions());
+
+// differentiate() with concrete ExpressionFunc callables instead of Func
+std::tuple<ExpressionFunc, ExpressionFunc, ExpressionFunc> differentiateDirect(const std::string &mathExpr, const DiffOptions &options = DiffOptions());
+
+// f, f', ..., f^(maxOrder) on one shared Expression; each order is built on its first call
+std::vector<Func> differentiateUpTo(const std::string &mathExpr, int maxOrder, const DiffOptions &options = DiffOptions());
+
+// All derivatives up to order n in one Taylor-mode pass over the tape of f.
+// No derivative trees are built, so the cost grows as O(n^2) per tape instruction.
+SeriesFunc differentiateN(const std::string &mathExpr, int n, const DiffOptions &options = DiffOptions());
+
+// One callable computing f, f', f'' together, sharing every subexpression
+// common to the three (forces shareSubexpressions)
+FusedFunc differentiateFused(const std::string &mathExpr, const DiffOptions &options = DiffOptions());
+
+// f, f', f'' compiled to native code through JitModule. Without the JIT
+// (or if compiling fails) they evaluate through the Expression like differentiate().
+NativeFuncs differentiateNative(const std::string &mathExpr, const DiffOptions &options = DiffOptions());
+
+
+// differentiate() evaluated in the precision of T (float, double or long double)
+template <typename T>
+std::tuple<BasicFunc<T>, BasicFunc<T>, BasicFunc<T>> differentiateAs(const std::string &mathExpr, const DiffOptions &options = DiffOptions()) {
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
+
+    BasicFunc<T> f = [expr](std::complex<T> x) { return expr -> evalAs<T>(0, x); };
+    BasicFunc<T> f1 = [expr](std::complex<T> x) { return expr -> evalAs<T>(1, x); };
+    BasicFunc<T> f2 = [expr](std::complex<T> x) { return expr -> evalAs<T>(2, x); };
+
+    return std::make_tuple(f, f1, f2);
+}
+
+
+
+#endif // DIFFERENTIATOR_HPP
@@ -0,0 +1,146 @@
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <atomic>
+#include <complex>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "arena.hpp"
+#include "intern.hpp"
+#include "simplify.hpp"
+#include "tape.hpp"
+#include "thread_pool.hpp"
+
+
+
+// How f' and f'' are obtained
+enum class Engine {
+    Symbolic,   // Build derivative trees with deriv() and evaluate them
+    Jet         // Propagate Taylor jets through the tape of f; no derivative trees are built
+};
+
+
+// Options controlling how f, f', f'' are built and evaluated
+struct DiffOptions {
+    Engine engine = Engine::Symbolic;
+    bool useTape = false;               // Evaluate through a compiled Tape instead of Node::eval
+    bool shareSubexpressions = false;   // Intern f, f', f'' into one DAG, evaluated through a Tape
+    bool simplify = true;               // Run the algebraic simplifier on each tree
+    bool polynomials = true;            // Collect polynomial subtrees into PolyNodes (see poly.hpp)
+    SimplifyReport *report = nullptr;   // If set, receives node counts before/after simplify (builds f', f'' eagerly)
+    bool useArena = true;               // Build all nodes in one NodeArena owned by the Expression
+};
+
+
+/**
+ * @brief A parsed expression together with its derivatives.
+ *
+ * f is parsed and compiled on construction. The tree and tape of every
+ * higher order n are built the first time order n is used, from the tree
+ * of order n - 1, exactly once even when several threads ask at the same
+ * time. Callers that only need f and f' never pay for f''. Built orders
+ * are never modified, so one Expression can be evaluated from several
+ * threads at once.
+ */
+class Expression {
+public:
+    explicit Expression(const std::string &mathExpr, const DiffOptions &options = DiffOptions());
+
+    Expression(const Expression &) = delete;
+    Expression &operator=(const Expression &) = delete;
+
+    // Evaluate the derivative of the given order (0 is f itself) at x
+    Complex eval(int order, const Complex &x) const;
+
+    // f, f', f'' at x from a single forward-mode pass over the tape of f
+    Jet evalJet(const Complex &x) const;
+
+    // f, f', f'' at x in one shared evaluation: one tape holding all three
+    // trees (Engine::Symbolic) or one jet pass (Engine::Jet)
+    Jet evalAll(const Complex &x) const;
+
+    // Boxes containing f, f', f'' at every point of the box x, from one
+    // interval pass over the tape of f; see Tape::evalBox
+    BoxJet bound(const Box &x) const;
+
+    // Taylor-mode evaluation on the tape of f, for any order without building
+    // derivative trees: coeffs[k] = f^(k)(x) / k!, derivs[k] = f^(k)(x), k <= maxOrder
+    void evalTaylor(const Complex &x, int maxOrder, Complex *coeffs) const;
+    void evalDerivatives(const Complex &x, int maxOrder, Complex *derivs) const;
+
+    // out[i] = f^(order)(in[i]) for i < n, walking the tape once per block of points
+    void evalBatch(int order, const Complex *in, Complex *out, size_t n) const;
+
+    // eval() in the precision of T; anything but long double runs on the tape
+    template <typename T>
+    std::complex<T> evalAs(int order, const std::complex<T> &x) const;
+
+    // evalBatch() in the precision of T
+    template <typename T>
+    void evalBatchAs(int order, const std::complex<T> *in, std::complex<T> *out, size_t n) const;
+
+    // Double-precision evalBatch() over split real/imaginary (SoA) arrays
+    void evalBatchSoA(int order, const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n) const;
+
+    // evalBatch() / evalBatchSoA() with the points split across the pool's threads.
+    // All threads share the read-only tape; results are written in input order.
+    void evalParallel(int order, const Complex *in, Complex *out, size_t n, ThreadPool &pool) const;
+    void evalParallelSoA(int order, const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n, ThreadPool &pool) const;
+
+    // Points handed to a thread at a time by evalParallel()
+    static constexpr size_t parallelChunk = 4 * Tape::blockSize;
+
+    // The returned pointer keeps this Expression's node storage alive.
+    // Both build the order if it has not been built yet.
+    NodePtr tree(int order) const;
+    const Tape &tape(int order) const;
+
+    // Approximate bytes owned by this Expression (nodes and tapes of the orders built so far)
+    size_t memoryBytes() const;
+
+    // Orders (and the fused tape) built so far; memoryBytes() changes only when this does
+    size_t buildCount() const { return builds.load(); }
+
+private:
+    // Tree and tape of one derivative order, filled once under `built`
+    struct Order {
+        std::once_flag built;
+        NodePtr tree;
+        Tape tape;
+    };
+
+    DiffOptions options;
+    std::shared_ptr<NodeArena> arena;       // Owns the nodes of trees when useArena is set
+    std::unique_ptr<NodeFactory> factory;   // Shared by all orders when shareSubexpressions is set
+
+    mutable std::mutex buildMutex;          // Serializes building (arena and factory are single-threaded)
+    mutable Order low[3];                   // f, f', f''
+    mutable std::deque<Order> high;         // Orders 3, 4, ...; grows under highMutex
+    mutable std::mutex highMutex;
+
+    mutable std::once_flag fusedBuilt;
+    mutable Tape fused;     // f, f', f'' as the three outputs of one tape
+
+    mutable std::atomic<size_t> builds{0};
+
+    bool usesJet(int order) const { return ( order == 1 || order == 2 ) && options.engine == Engine::Jet; }
+
+    // The order's slot, built on first use
+    const Order &get(int order) const;
+    void build(int order, Order &slot, const std::string *source) const;
+    const Tape &fusedTape() const;
+};
+
+
+// Largest relative difference of f' and f'' between Engine::Jet and
+// Engine::Symbolic over the given points (points where both are NaN are skipped)
+long double engineDeviation(const std::string &mathExpr, const std::vector<Complex> &points);
+
+
+
+#endif // EXPRESSION_HPP
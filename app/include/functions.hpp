@@ -0,0 +1,72 @@
+#ifndef FUNCTIONS_HPP
+#define FUNCTIONS_HPP
+
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "ast.hpp"
+#include "interval.hpp"
+
+
+
+/**
+ * @brief Registry entry of a unary function g.
+ *
+ * Adding a function means one FuncId, one registry row in functions.cpp
+ * and one case in applyFunc(); evaluators never compare names.
+ */
+struct FuncInfo {
+    FuncId id;
+    const char *name;
+
+    // Outer derivative g'(u) as a tree, for the chain rule (g o u)' = g'(u) * u'
+    NodePtr (*deriv)(const NodePtr &u);
+
+    // g(z), g'(z) and g''(z) at a point, for forward-mode jets
+    void (*jet)(const Complex &z, Complex &g, Complex &d1, Complex &d2);
+
+    // Taylor coefficients g[0..n-1] of g(u) from those of u (see series.hpp)
+    void (*taylor)(const Complex *u, Complex *g, size_t n);
+
+    // Boxes containing g, g', g'' over a box, for interval jets (see interval.hpp)
+    void (*box)(const Box &z, Box &g, Box &d1, Box &d2);
+};
+
+
+const FuncInfo &funcInfo(FuncId id);
+
+// Number of FuncId values
+constexpr size_t funcCount = static_cast<size_t>(FuncId::Atan) + 1;
+
+// Registry lookup by name, nullptr if there is no such function
+const FuncInfo *findFunc(std::string_view name);
+
+
+// Evaluate g(z) in any precision
+template <typename T>
+std::complex<T> applyFunc(FuncId id, const std::complex<T> &z) {
+    switch (id) {
+        case FuncId::Sin:   return std::sin(z);
+        case FuncId::Cos:   return std::cos(z);
+        case FuncId::Tan:   return std::tan(z);
+        case FuncId::Cot:   return std::complex<T>(1.0) / std::tan(z);
+        case FuncId::Log:   return std::log(z);
+        case FuncId::Exp:   return std::exp(z);
+        case FuncId::Sqrt:  return std::sqrt(z);
+        case FuncId::Sinh:  return std::sinh(z);
+        case FuncId::Cosh:  return std::cosh(z);
+        case FuncId::Tanh:  return std::tanh(z);
+        case FuncId::Asin:  return std::asin(z);
+        case FuncId::Acos:  return std::acos(z);
+        case FuncId::Atan:  return std::atan(z);
+    }
+
+    throw std::runtime_error("Unknown func");
+}
+
+
+
+#endif // FUNCTIONS_HPP
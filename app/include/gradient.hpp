@@ -0,0 +1,86 @@
+#ifndef GRADIENT_HPP
+#define GRADIENT_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "symbols.hpp"
+#include "tape.hpp"
+
+
+
+// All first partials of f by the variables 0 .. variables-1, from one
+// reverse (adjoint) sweep over f: each node's adjoint is built once and
+// shared by every partial that needs it, instead of one deriv() walk per
+// variable. Partials by variables f does not read are 0.
+std::vector<NodePtr> gradient(const NodePtr &f, size_t variables);
+
+
+/**
+ * @brief An expression in several named variables, with gradient and Hessian.
+ *
+ * Every identifier that is not a function call is a variable; the
+ * vectors passed in are indexed as in symbols(). The gradient trees come
+ * from one adjoint sweep over f, the Hessian from one sweep per gradient
+ * entry; each set is interned into one DAG and compiled into one tape,
+ * so a subexpression shared by several partials is evaluated once per
+ * point. The Hessian tape is built on first use. Evaluation only reads
+ * the built tapes, so one MultiExpression can be used from several threads.
+ */
+class MultiExpression {
+public:
+    // Variables numbered in order of first appearance
+    explicit MultiExpression(std::string_view mathExpr);
+
+    // Variables already in symbols keep their indices, new ones are added
+    // to it; the expression keeps a copy of the table as it is after parsing
+    MultiExpression(std::string_view mathExpr, SymbolTable &symbols);
+
+    MultiExpression(const MultiExpression &) = delete;
+    MultiExpression &operator=(const MultiExpression &) = delete;
+
+    const SymbolTable &symbols() const { return table; }
+    size_t variableCount() const { return table.size(); }
+
+    // f at the point vars[0 .. variableCount()-1]
+    Complex eval(const Complex *vars) const;
+
+    // f and grad[i] = df/dvar_i from one pass over the gradient tape; returns f
+    Complex gradient(const Complex *vars, Complex *grad) const;
+
+    // f, the gradient and the symmetric Hessian, row-major:
+    // hess[i * n + j] = d2f / dvar_i dvar_j; returns f
+    Complex hessian(const Complex *vars, Complex *grad, Complex *hess) const;
+
+    NodePtr tree() const { return f; }
+
+    // The trees of df/dvar_i, sharing subtrees with each other and with f
+    const std::vector<NodePtr> &gradientTrees() const { return partials; }
+
+    // The tape of f alone; AdjointTape(tape()) gives the gradient by a
+    // numeric reverse sweep, without the gradient trees
+    const Tape &tape() const { return valueTape; }
+
+    // Tape outputs: f, then the gradient (and then the upper triangle of the Hessian)
+    const Tape &gradientTape() const { return gradTape; }
+    const Tape &hessianTape() const;
+
+private:
+    SymbolTable table;
+    NodePtr f;
+    std::vector<NodePtr> partials;
+    Tape valueTape;     // f alone
+    Tape gradTape;
+
+    mutable std::once_flag hessBuilt;
+    mutable Tape hessTape;
+
+    void build();
+};
+
+
+
+#endif // GRADIENT_HPP
@@ -0,0 +1,90 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ast.hpp"
+#include "differentiator.hpp"
+#include "intern.hpp"
+#include "parser.hpp"
+#include "simplify.hpp"
+
+
+
+// What the last IncrementalDifferentiator::update() reused and rebuilt
+struct IncrementalStats {
+    size_t reusedGroups = 0;    // Parenthesized groups taken over from the previous input
+    size_t parsedBytes = 0;     // Input bytes tokenized and parsed again
+    size_t newNodes = 0;        // Canonical nodes created for f, f', f''
+    size_t newDerivatives = 0;  // Nodes differentiated
+    size_t retained = 0;        // Entries the factory keeps besides its unique nodes (NodeFactory::retained())
+    bool rebuilt = false;       // Nothing was reused (first input, or the state was compacted)
+};
+
+
+/**
+ * @brief Re-differentiates an expression that changes by small edits.
+ *
+ * Each update() compares the input with the previous one. Parenthesized
+ * groups (and call arguments) lying wholly before or after the changed
+ * range keep their parsed trees, and only the text around them is
+ * tokenized and parsed again. Every tree then goes through one
+ * NodeFactory, so unchanged subexpressions come out as the same
+ * canonical nodes as before, and the simplifier and derivative results
+ * memoized for those nodes are reused: only new nodes are visited.
+ *
+ * f, f', f'' are simplified as in Expression and evaluated as trees;
+ * building a tape or collecting polynomials would take a pass over the
+ * whole tree. The raw parse of each input is not kept, only canonical
+ * nodes and what the memos derived from them, so memory grows only with
+ * new subexpressions; once the factory holds far more nodes than the
+ * current trees need, the state is dropped and the next update starts
+ * from scratch.
+ */
+class IncrementalDifferentiator {
+public:
+    IncrementalDifferentiator();
+    ~IncrementalDifferentiator();
+
+    IncrementalDifferentiator(const IncrementalDifferentiator &) = delete;
+    IncrementalDifferentiator &operator=(const IncrementalDifferentiator &) = delete;
+
+    // f, f', f'' of mathExpr, as differentiate() but reusing the previous
+    // updates' work. A syntax error (ParseError) leaves the state unchanged.
+    std::tuple<Func, Func, Func> update(const std::string &mathExpr);
+
+    // f, f', f'' (order 0 to 2) of the last successful update
+    NodePtr tree(int order) const;
+
+    const IncrementalStats &stats() const { return last; }
+
+    // Drop everything kept from earlier updates
+    void clear();
+
+    // The factory may hold this many times the nodes of a fresh build before it is dropped
+    static constexpr size_t compactFactor = 4;
+
+private:
+    std::string text;                               // Last successful input
+    std::vector<Parser::ParsedGroup> groups;        // Its groups, by input offsets, with canonical trees
+    NodePtr trees[3];
+
+    std::unique_ptr<NodeFactory> factory;
+    std::unique_ptr<SimplifyCache> simplifier;
+    std::unique_ptr<DerivCache> derivs;             // d/dx of canonical nodes of every order
+    size_t freshSize = 0;                           // factory -> size() after the last rebuild
+
+    IncrementalStats last;
+
+    // The raw tree of mathExpr, reusing the groups of text; fills next with
+    // its groups and stats with what was reused and parsed
+    NodePtr parse(const std::string &mathExpr, std::vector<Parser::ParsedGroup> &next, IncrementalStats &stats);
+};
+
+
+
+#endif // INCREMENTAL_HPP
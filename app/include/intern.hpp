@@ -0,0 +1,82 @@
+#ifndef INTERN_HPP
+#define INTERN_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+
+
+
+/**
+ * @brief Hash-consing node factory.
+ *
+ * Structurally equal nodes are created only once and shared, so trees
+ * built through one factory form a DAG of unique subexpressions.
+ * Compiling such a DAG with Tape::compile evaluates every unique node
+ * once per input point. Nodes whose operands are all constants are
+ * folded into one constant as they are built.
+ */
+class NodeFactory {
+public:
+    NodePtr constant(const Complex &value);
+    NodePtr variable(std::uint32_t index = 0);
+    NodePtr binary(char op, NodePtr l, NodePtr r);
+    NodePtr power(NodePtr b, NodePtr e);
+    NodePtr intPower(NodePtr b, std::int32_t n);
+    NodePtr func(FuncId id, NodePtr arg);
+    NodePtr poly(NodePtr arg, std::vector<Complex> coeffs);
+
+    // Rebuild an existing tree bottom-up through the factory; subtrees
+    // interned before (or canonical already) are not walked again
+    NodePtr intern(const NodePtr &tree);
+
+    // intern() for a tree dropped after use, such as a fresh parse: its own
+    // nodes are not remembered or kept alive. Each of subtrees (nodes of
+    // tree, or canonical ones) is replaced by its canonical node as well.
+    NodePtr internTemporary(const NodePtr &tree, std::vector<NodePtr> &subtrees);
+
+    // Number of unique nodes created so far
+    size_t size() const { return nodes.size(); }
+
+    // Entries kept besides the unique nodes: roots passed to intern() and
+    // the nodes of those trees, mapped to their canonical nodes
+    size_t retained() const { return inputs.size() + interned.size() - nodes.size(); }
+
+private:
+    // Structural identity: kind, operator or FuncId, constant value, exponent or
+    // variable index, canonical children, and a polynomial's coefficients (which
+    // point into the node the key maps to, or into the candidate being looked up)
+    struct Key {
+        std::uint8_t kind;
+        char op;
+        Complex value;
+        const Node *a;
+        const Node *b;
+        const std::vector<Complex> *coeffs = nullptr;
+
+        bool operator==(const Key &other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    std::unordered_map<Key, NodePtr, KeyHash> nodes;
+    std::unordered_map<const Node *, NodePtr> interned;    // Input node -> canonical node; canonical nodes map to themselves
+    std::vector<NodePtr> inputs;                            // Roots passed to intern()
+
+    NodePtr internNode(const NodePtr &tree);
+
+    // Interns every node of tree into `interned`; the non-canonical ones
+    // added are appended to added, if given
+    void walk(const NodePtr &tree, std::vector<const Node *> *added);
+
+    // node, or its value as a canonical constant if it has no x below it
+    NodePtr folded(const NodePtr &node);
+};
+
+
+
+#endif // INTERN_HPP
@@ -0,0 +1,99 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include <cstdint>
+
+#include "ast.hpp"
+
+
+
+// Closed real interval [lo, hi]; an empty or NaN result widens to the whole line
+struct Interval {
+    long double lo = 0.0;
+    long double hi = 0.0;
+
+    bool contains(long double v) const { return lo <= v && v <= hi; }
+    bool isZero() const { return lo == 0.0 && hi == 0.0; }
+};
+
+
+// Rectangle re x im of the complex plane
+struct Box {
+    Interval re;
+    Interval im;
+
+    Box() = default;
+    Box(Interval r, Interval i) : re(r), im(i) {}
+
+    // The single point z
+    explicit Box(const Complex &z) : re{ z.real(), z.real() }, im{ z.imag(), z.imag() } {}
+
+    // [lo.re, hi.re] x [lo.im, hi.im]
+    static Box corners(const Complex &lo, const Complex &hi) {
+        return Box({ lo.real(), hi.real() }, { lo.imag(), hi.imag() });
+    }
+
+    bool contains(const Complex &z) const { return re.contains(z.real()) && im.contains(z.imag()); }
+    bool containsZero() const { return re.contains(0.0) && im.contains(0.0); }
+    bool isZero() const { return re.isZero() && im.isZero(); }
+};
+
+
+// Boxes containing a + b, a - b, a * b, a / b for all a, b in the operands
+Box operator+(const Box &a, const Box &b);
+Box operator-(const Box &a, const Box &b);
+Box operator*(const Box &a, const Box &b);
+Box operator/(const Box &a, const Box &b);
+
+// -a, exact
+Box operator-(const Box &a);
+
+
+// Bounds of f, f', f'' over a box (see Tape::evalBox)
+struct BoxJet {
+    Box f;
+    Box f1;
+    Box f2;
+};
+
+
+/**
+ * @brief Rectangular complex interval arithmetic.
+ *
+ * Like the Box operators, every operation returns a box containing op(z)
+ * for every z in its operand boxes, with bounds rounded outward, so a
+ * composition of operations bounds the composed function. The functions
+ * are the principal branches std::complex uses; sqrt, pow and the inverse
+ * functions are built on log, and a box touching the negative real axis
+ * takes arg over all of [-pi, pi], which covers both sides of every cut. Division by a box containing 0 gives
+ * the whole plane.
+ */
+namespace interval {
+
+// The whole real line and the whole plane
+Interval entire();
+Box plane();
+
+Box sqr(const Box &a);      // a * a, tighter than the product
+Box powInt(const Box &a, std::int32_t n);
+Box pow(const Box &a, const Box &b);    // exp(b log a)
+
+Box exp(const Box &a);
+Box log(const Box &a);
+Box sqrt(const Box &a);
+Box sin(const Box &a);
+Box cos(const Box &a);
+Box tan(const Box &a);
+Box cot(const Box &a);
+Box sinh(const Box &a);
+Box cosh(const Box &a);
+Box tanh(const Box &a);
+Box asin(const Box &a);
+Box acos(const Box &a);
+Box atan(const Box &a);
+
+} // namespace interval
+
+
+
+#endif // INTERVAL_HPP
@@ -0,0 +1,66 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+
+
+
+/**
+ * @brief Expression trees compiled to native code at runtime.
+ *
+ * The trees are lowered to C99 complex arithmetic (one temporary per
+ * unique node, in the same operation order as Node::eval), built into a
+ * shared object with the system C compiler and loaded with dlopen.
+ * Built objects are cached on disk by a hash of their source, so the
+ * same expression is compiled only once per machine.
+ *
+ * Only available in builds with DIFF_ENABLE_JIT (make jit); elsewhere
+ * compile() throws and callers fall back to the tree evaluator.
+ *
+ * Environment: DIFF_JIT_CC (compiler, default "cc"), DIFF_JIT_CACHE
+ * (cache directory, default $TMPDIR/differentiate-jit-<uid>). The cache
+ * directory must be owned by the user and have mode 0700; if it is not,
+ * compile() throws rather than load objects others could have placed.
+ */
+class JitModule {
+public:
+    // Compile the trees into one module with one entry point per tree
+    static std::shared_ptr<const JitModule> compile(const std::vector<NodePtr> &trees);
+
+    // Whether this build contains the JIT backend
+    static bool available();
+
+    // The C source compile() builds for these trees
+    static std::string generateSource(const std::vector<NodePtr> &trees);
+
+    ~JitModule();
+
+    JitModule(const JitModule &) = delete;
+    JitModule &operator=(const JitModule &) = delete;
+
+    // Value of the i-th compiled tree at x
+    Complex eval(size_t output, const Complex &x) const;
+
+    // out[j] = eval(output, in[j]) for j < n
+    void evalBatch(size_t output, const Complex *in, Complex *out, size_t n) const;
+
+    size_t outputCount() const { return scalar.size(); }
+
+private:
+    using ScalarFn = void (*)(const long double *in, long double *out);
+    using BatchFn = void (*)(const long double *in, long double *out, size_t n);
+
+    JitModule() = default;
+
+    void *handle = nullptr;     // dlopen handle
+    std::vector<ScalarFn> scalar;
+    std::vector<BatchFn> batch;
+};
+
+
+
+#endif // JIT_HPP
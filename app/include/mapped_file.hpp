@@ -0,0 +1,46 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+
+
+/**
+ * @brief A whole file mapped into memory with mmap.
+ *
+ * Pages are loaded by the kernel on first touch, so files much larger
+ * than RAM can be streamed through. Writable mappings are shared with
+ * the file and written back on unmap.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Map an existing file read-only
+    static MappedFile openRead(const std::string &path);
+
+    // Create (or truncate) a file of the given size and map it read-write
+    static MappedFile create(const std::string &path, size_t bytes);
+
+    const void *data() const { return address; }
+    void *data() { return address; }
+    size_t size() const { return bytes; }
+
+private:
+    void *address = nullptr;
+    size_t bytes = 0;
+
+    void unmap();
+};
+
+
+
+#endif // MAPPED_FILE_HPP
@@ -1,42 +1,88 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
-#include <string>
+#include <cstddef>
+#include <string_view>
+#include <vector>
 
 #include "ast.hpp" 
+#include "symbols.hpp"
+#include "tokenizer.hpp"
 
 
 
 /**
- * @brief Recursive descent parser for math expressions in BNF.
+ * @brief Operator-precedence parser for math expressions in BNF.
  *
  * Takes a math expression and builds an AST
  * The parser handles basic arithmetic,
  * exponentiation, parentheses, trig functions
+ * The input is tokenized once up front and the grammar walks the
+ * token stream; tokens view the input, so it must outlive the Parser.
+ * Operators and open parentheses are kept on explicit stacks instead of
+ * the call stack, so nesting depth is limited only by memory.
+ * Syntax errors are ParseErrors carrying the offending input offset.
+ * Without a SymbolTable the only variable is x; with one, every name
+ * not followed by '(' is a variable, declared in the table on first use.
+ *
+ * <expression> ::= <term> ( ( "+" | "-" ) <term> )*
+ * <term>       ::= <factor> ( ( "*" | "/" ) <factor> )*
+ * <factor>     ::= <basic> [ "^" <factor> ]
+ * <basic>      ::= <number> | "x" | <func_call> | "(" <expression> ")"
+ *
+ * A group "(" <expression> ")" parses to the same tree wherever it stands,
+ * so a prepared token stream can hold Group tokens standing for groups
+ * parsed before (see IncrementalDifferentiator).
  */
 class Parser {
 public:
-    explicit Parser(std::string mathExpr);
+    explicit Parser(std::string_view mathExpr);
+    Parser(std::string_view mathExpr, SymbolTable &symbols);
+
+    // A prepared token stream ending with an End token, where the Group
+    // token with index i is the parenthesized group whose tree is groups[i]
+    Parser(std::vector<Token> tokens, std::vector<NodePtr> groups);
 
     NodePtr parse();
 
+    // One parenthesized group or call argument: input offsets of "(" and one
+    // past ")", and the tree of the expression inside
+    struct ParsedGroup {
+        size_t begin;
+        size_t end;
+        NodePtr tree;
+    };
+
+    // Have parse() append every group it parses to out, innermost first
+    // (Group tokens are not parsed, so not appended again)
+    void recordGroups(std::vector<ParsedGroup> *out) { recorded = out; }
+
 private:
-    std::string inputString; // Input expression string.
-    size_t currPos;
+    // Pending operator or open parenthesis
+    struct Pending {
+        TokenKind kind;     // Operator, or LParen for an open parenthesis
+        bool call;          // LParen opening a function call
+        FuncId func;        // The function, if call
+        size_t pos = 0;     // Input offset of the parenthesis, if LParen
+    };
 
-    void skipWhitespace();
+    std::vector<Token> tokens; // Token stream, ending with an End token
+    size_t currTok;
+    SymbolTable *symbols = nullptr;     // Variables by name, if given
+    std::vector<NodePtr> groups;        // Trees of the Group tokens
+    std::vector<ParsedGroup> *recorded = nullptr;
 
-    // <expression> ::= <term> ( ( "+" | "-" ) <term> )*
-    NodePtr parseExpression();
+    std::vector<NodePtr> operands;
+    std::vector<Pending> pending;
 
-    // <term> ::= <factor> { ('*' | '/') <factor> }
-    NodePtr parseTerm();
+    const Token &peek() const { return tokens[currTok]; }
 
-    // <factor> ::= <basic> ( "^" <basic> )*
-    NodePtr parseFactor();
+    // Expect an operand: push a leaf, or open a parenthesis
+    // Returns true once an operand is complete
+    bool parseOperand();
 
-    // <basic> ::= <number> | 'x' | <func_call> | '(' <expression> ')'
-    NodePtr parseBasic();
+    // Combine the two topmost operands with the topmost operator
+    void reduce();
 };
 
 
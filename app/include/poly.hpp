@@ -0,0 +1,33 @@
+#ifndef POLY_HPP
+#define POLY_HPP
+
+#include <cstddef>
+
+#include "ast.hpp"
+
+
+
+/**
+ * @brief Collects polynomial subtrees into PolyNodes.
+ *
+ * Every subtree is read bottom-up as a polynomial in one argument u: a
+ * variable, or any subtree that is not itself polynomial (sin(x), x^y,
+ * ...). Constants, +, -, division by a nonzero constant, products with a
+ * constant or of two monomials, and u^n (n >= 0) of a monomial combine
+ * polynomials in the same argument (the same variable, or one shared
+ * node) up to maxPolyDegree. Products and powers of sums are not
+ * expanded: (x - 1)^5 in coefficients cancels catastrophically near
+ * x = 1, so only sums of scaled monomials become PolyNodes.
+ * A polynomial subtree is replaced by one PolyNode over its coefficients
+ * when it holds at least two operations and Horner's rule needs no more
+ * multiplications than the tree did, so x^20 + 1 is kept while
+ * 3*x^2 + 2*x + 1 becomes one node. Rational functions end up as a
+ * quotient of two PolyNodes. Unchanged subtrees are returned as-is.
+ */
+NodePtr collectPolynomials(const NodePtr &tree);
+
+constexpr size_t maxPolyDegree = 32;
+
+
+
+#endif // POLY_HPP
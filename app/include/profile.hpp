@@ -0,0 +1,93 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "ast.hpp"
+#include "tape.hpp"
+
+
+
+/**
+ * @brief Opt-in evaluation profiler, compiled in with -DDIFF_PROFILE.
+ *
+ * Counts evaluations and accumulates self time (children excluded) per
+ * node type and per function, for Node::eval and the scalar tape loop.
+ * Without DIFF_PROFILE the hooks expand to nothing, so normal builds pay
+ * no cost. Counters are global and atomic, so profiles from several
+ * threads add up. Tree statistics are available in every build.
+ */
+namespace profile {
+
+// Counter slots: node types / opcodes first, then one per FuncId
+enum Slot : std::uint8_t { Const, Var, Add, Sub, Mul, Div, Pow, Poly, FirstFunc };
+
+size_t slotCount();
+const char *slotName(size_t slot);
+
+size_t binarySlot(char op);
+size_t funcSlot(FuncId id);
+size_t opSlot(OpCode op, std::uint32_t b);
+
+
+struct Entry {
+    const char *name;
+    std::uint64_t count;
+    double seconds;     // Self time
+};
+
+// Whether this build has DIFF_PROFILE
+bool enabled();
+
+// Entries with a non-zero count, in slot order
+std::vector<Entry> snapshot();
+void reset();
+
+// Table of snapshot() sorted by time
+void report(std::ostream &out);
+
+void record(size_t slot, std::uint64_t nanos);
+
+
+// Times one evaluation; time spent in nested scopes is charged to them
+class Scope {
+public:
+    explicit Scope(size_t slot);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    size_t slot;
+    std::uint64_t savedChildren;
+    std::chrono::steady_clock::time_point start;
+};
+
+
+// Size of a tree when expanded (shared subtrees counted each time they
+// occur, saturating), distinct nodes, and depth (a leaf has depth 1)
+struct TreeStats {
+    std::uint64_t nodes = 0;
+    size_t uniqueNodes = 0;
+    size_t depth = 0;
+};
+
+TreeStats treeStats(const NodePtr &tree);
+
+} // namespace profile
+
+
+#ifdef DIFF_PROFILE
+#define DIFF_PROFILE_EVAL(slot) ::profile::Scope diffProfileScope(slot)
+#else
+#define DIFF_PROFILE_EVAL(slot) do {} while (0)
+#endif
+
+
+
+#endif // PROFILE_HPP
@@ -0,0 +1,51 @@
+#ifndef SERIES_HPP
+#define SERIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ast.hpp"
+
+
+
+/**
+ * @brief Arithmetic on truncated Taylor series.
+ *
+ * A series is an array of n coefficients a[0..n-1], a[k] = a^(k)(x) / k!.
+ * Every operation costs O(n^2) at most, independent of how the series
+ * was obtained. Outputs must not alias inputs.
+ */
+namespace series {
+
+// d = a * b (Cauchy product)
+void mul(const Complex *a, const Complex *b, Complex *d, size_t n);
+
+// d = a / b
+void div(const Complex *a, const Complex *b, Complex *d, size_t n);
+
+// d = a^b, with d[0] = std::pow(a[0], b[0]); a constant b uses the
+// power recurrence, a varying one exp(b log a)
+void pow(const Complex *a, const Complex *b, Complex *d, size_t n);
+
+// d = a^p for an integer p, with d[0] = powInt(a[0], p)
+void powInt(const Complex *a, std::int32_t p, Complex *d, size_t n);
+
+void exp(const Complex *a, Complex *d, size_t n);
+void log(const Complex *a, Complex *d, size_t n);
+void sqrt(const Complex *a, Complex *d, size_t n);
+
+// s = sin(a), c = cos(a) and s = sinh(a), c = cosh(a)
+void sinCos(const Complex *a, Complex *s, Complex *c, size_t n);
+void sinhCosh(const Complex *a, Complex *s, Complex *c, size_t n);
+
+// t with t' = (alpha + beta t^2) a', given t[0]: tan is (1, 1), tanh (1, -1), cot (-1, -1)
+void riccati(const Complex *a, Complex *t, long double alpha, long double beta, size_t n);
+
+// g with g' = h a', given g[0]: fills g[1..n-1]
+void integrate(const Complex *a, const Complex *h, Complex *g, size_t n);
+
+} // namespace series
+
+
+
+#endif // SERIES_HPP
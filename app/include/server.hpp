@@ -0,0 +1,177 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cache.hpp"
+#include "thread_pool.hpp"
+
+
+
+// Counters of a Server at one point in time
+struct ServerStats {
+    size_t connections = 0;     // Accepted so far
+    size_t open = 0;            // Connected now
+    size_t requests = 0;        // Point lines evaluated
+    size_t points = 0;
+    size_t errors = 0;
+    size_t batches = 0;         // Evaluations run on the pool
+    size_t queued = 0;          // Point lines waiting for a free worker
+    size_t inFlight = 0;        // Batches being evaluated
+
+    // Latency from receiving a point line to its reply being ready, in
+    // microseconds, over the last Server::latencyWindow requests
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+
+/**
+ * @brief Long-lived evaluation server on a Unix domain socket.
+ *
+ * Every connection speaks the record format of runStream() (stream.hpp):
+ * "@ <expression>" selects the connection's expression, a line of points
+ * is answered with one output line per point, and "?" is answered with
+ * one "stats key=value ..." line of ServerStats. Replies come back in
+ * the order of the lines they answer. An expression that fails to parse
+ * is reported as "error <line>: <message>" on each line of points using it.
+ *
+ * One thread (the caller of run()) does all socket I/O with poll().
+ * Point lines for the same expression, from any connection, queue up in
+ * one batch until a worker of the pool is free; the batch then runs as
+ * one Expression::evalBatch() per order, so batches grow with the load.
+ * Expressions come from the shared cache, so each is compiled once.
+ * A connection whose peer does not read its replies is not read from
+ * either once its backlog reaches maxOutputBytes, maxPendingReplies or
+ * maxPendingPoints.
+ */
+class Server {
+public:
+    // Listens on socketPath, replacing a stale socket there; any other file
+    // at socketPath is kept, and listening fails
+    Server(const std::string &socketPath, ExpressionCache &cache, ThreadPool &pool);
+    ~Server();
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    // Serve until stop(); the batches being evaluated are finished first,
+    // queued ones are dropped
+    void run();
+
+    // Makes run() return; async-signal-safe
+    void stop();
+
+    ServerStats stats() const;
+
+    static constexpr size_t maxBatchPoints = 1 << 14;   // A fuller batch for the same expression starts a new one
+    static constexpr size_t maxLineBytes = 1 << 20;     // Longer lines close the connection
+    static constexpr size_t latencyWindow = 1 << 16;
+    // A connection is not read while it has this much unsent output, this
+    // many unanswered lines or this many points in them
+    static constexpr size_t maxOutputBytes = 1 << 22;
+    static constexpr size_t maxPendingReplies = 1 << 12;
+    static constexpr size_t maxPendingPoints = 1 << 15;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Output of one line, filled by a worker or right away
+    struct Reply {
+        std::string text;
+        std::atomic<bool> ready{false};
+        size_t points = 0;      // Evaluated for it
+    };
+
+    // One line of points for a batch
+    struct Request {
+        std::shared_ptr<Reply> reply;
+        size_t line;
+        std::vector<Complex> points;
+        std::vector<std::pair<size_t, std::string>> invalid;   // (valid points before it, token)
+        Clock::time_point received;
+    };
+
+    struct Batch {
+        std::string key;        // Normalized expression
+        std::vector<Request> requests;
+        size_t points = 0;
+    };
+
+    struct Connection {
+        int fd;
+        std::string input;      // Received, not yet a whole line
+        std::string output;     // Ready, not yet sent
+        std::deque<std::shared_ptr<Reply>> replies;     // In line order, ready or not
+        size_t pendingPoints = 0;   // Sum of their points
+        std::string expression;     // Normalized; empty before the first "@"
+        size_t lines = 0;
+        bool closing = false;   // Nothing more to read; closed once the replies are sent
+        bool failed = false;    // Closed right away
+
+        explicit Connection(int f) : fd(f) {}
+        ~Connection();
+    };
+
+    const std::string path;
+    ExpressionCache &cache;
+    ThreadPool &pool;
+
+    // Self-pipe: workers and stop() wake the I/O thread. Each worker holds
+    // a reference, so its wake-up after the last batch needs no Server
+    struct WakePipe {
+        int readEnd = -1;
+        int writeEnd = -1;
+
+        ~WakePipe();
+        // A full pipe already holds a wake-up, so a failed write is harmless
+        void wake() const;
+    };
+
+    int listener = -1;
+    std::shared_ptr<WakePipe> wakePipe;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> inFlight{0};
+
+    // I/O thread only
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::deque<Batch> pending;                          // Oldest first
+    std::unordered_map<std::string, Batch *> filling;   // Expression -> its batch still taking requests
+
+    mutable std::mutex statsMutex;
+    ServerStats counters;
+    std::vector<double> latencies;  // Ring of the last latencyWindow samples
+    size_t latencyNext = 0;
+
+    void accept();
+    void read(Connection &conn);
+    void write(Connection &conn);
+
+    // At one of the limits above: read no more until the peer catches up
+    static bool backlogged(const Connection &conn);
+    void handleLine(Connection &conn, std::string line);
+    void enqueue(Connection &conn, Request request);
+    void dispatch();
+    void evaluate(Batch &batch);
+
+    // A reply that is ready now
+    void answer(Connection &conn, std::string text, size_t errors);
+};
+
+// One "stats key=value ..." line, newline included
+std::string formatStats(const ServerStats &stats);
+
+
+
+#endif // SERVER_HPP
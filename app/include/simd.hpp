@@ -0,0 +1,46 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+/**
+ * @brief Complex kernels over split real/imaginary (SoA) double arrays.
+ *
+ * Every kernel computes d[j] = op(a[j], b[j]) for j < n, with the real
+ * and imaginary parts in separate arrays. +, -, *, / use AVX-512 or AVX2
+ * when the build enables them (e.g. make SIMDFLAGS=-march=native), the
+ * function kernels run on real double math per lane. Outputs may alias
+ * inputs lane by lane.
+ */
+namespace simd {
+
+void add(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n);
+void sub(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n);
+void mul(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n);
+void div(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n);
+void pow(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n);
+
+// d = a^p for an integer p, by repeated squaring as powInt()
+void powInt(const double *ar, const double *ai, std::int32_t p, double *dr, double *di, size_t n);
+
+void sin(const double *ar, const double *ai, double *dr, double *di, size_t n);
+void cos(const double *ar, const double *ai, double *dr, double *di, size_t n);
+void tan(const double *ar, const double *ai, double *dr, double *di, size_t n);
+void cot(const double *ar, const double *ai, double *dr, double *di, size_t n);
+void log(const double *ar, const double *ai, double *dr, double *di, size_t n);
+
+// d = c[0] + c[1] a + ... + c[degree] a^degree by Horner's rule, with the
+// coefficients split into cr, ci like the lanes
+void horner(const double *cr, const double *ci, size_t degree, const double *ar, const double *ai, double *dr, double *di, size_t n);
+
+// Instruction set the arithmetic kernels were built for: "avx512", "avx2" or "scalar"
+const char *isa();
+
+} // namespace simd
+
+
+
+#endif // SIMD_HPP
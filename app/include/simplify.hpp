@@ -0,0 +1,53 @@
+#ifndef SIMPLIFY_HPP
+#define SIMPLIFY_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include "ast.hpp"
+
+
+
+// Node counts of f, f', f'' before and after simplification
+struct SimplifyReport {
+    size_t nodesBefore[3] = {};
+    size_t nodesAfter[3] = {};
+};
+
+
+/**
+ * @brief Algebraic rewriting of a tree, bottom-up.
+ *
+ * Rules: constant folding (see foldConstant(), complex values included), 0*a -> 0, 1*a -> a, a+0 -> a, a-0 -> a,
+ * a/1 -> a, 0/a -> 0, a^0 -> 1, a^1 -> a. A power whose exponent becomes
+ * constant is rebuilt with makePower().
+ * Unchanged subtrees are returned as-is, so sharing is preserved.
+ */
+NodePtr simplify(const NodePtr &tree);
+
+
+// simplify() with the result for every node kept across calls, so a tree
+// sharing nodes by pointer with earlier ones gets only its new nodes
+// rewritten. The trees passed are kept alive, as in DerivCache.
+class SimplifyCache {
+public:
+    SimplifyCache();
+    ~SimplifyCache();
+
+    SimplifyCache(const SimplifyCache &) = delete;
+    SimplifyCache &operator=(const SimplifyCache &) = delete;
+
+    NodePtr simplify(const NodePtr &tree);
+
+private:
+    struct Memo;
+
+    std::unique_ptr<Memo> memo;
+};
+
+// Number of distinct nodes reachable from tree (shared nodes count once)
+size_t countNodes(const NodePtr &tree);
+
+
+
+#endif // SIMPLIFY_HPP
@@ -0,0 +1,50 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+#include "cache.hpp"
+
+
+
+/**
+ * @brief Bulk evaluation over newline-delimited records.
+ *
+ * Input records, one per line:
+ *
+ *   @ <expression>          make <expression> the current expression
+ *   <point> <point> ...     evaluate the current expression at each point
+ *   # ...                   comment (blank lines are ignored too)
+ *
+ * A point is "re" or "re,im". Each point produces one output line
+ *
+ *   re im  f.re f.im  f'.re f'.im  f''.re f''.im
+ *
+ * with all numbers at full long double precision. A bad record produces
+ * "error <line>: <message>" instead and processing continues. Expressions
+ * come from the cache, so repeated ones are compiled only once, and output
+ * is written in large blocks.
+ */
+struct StreamStats {
+    size_t lines = 0;
+    size_t expressions = 0;
+    size_t points = 0;
+    size_t errors = 0;
+};
+
+StreamStats runStream(std::istream &in, std::ostream &out, ExpressionCache &cache);
+
+// Parses a point, "re" or "re,im"; false if the token is not one
+bool parsePoint(const std::string &token, Complex &z);
+
+// Appends the output line of one point, newline included
+void appendRecord(std::string &out, const Complex &z, const Jet &jet);
+
+// Appends "error <line>: <message>" and a newline
+void appendError(std::string &out, size_t line, const std::string &message);
+
+
+
+#endif // STREAM_HPP
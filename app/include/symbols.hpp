@@ -0,0 +1,43 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+
+/**
+ * @brief Variable names and their positions in the variable vector.
+ *
+ * Indices are handed out in order of declaration, starting at 0, and
+ * never change; VarNode::index and the vectors passed to the
+ * multivariate evaluators are indexed the same way.
+ */
+class SymbolTable {
+public:
+    SymbolTable() = default;
+
+    // Declare the names in order: names[i] gets index i
+    explicit SymbolTable(const std::vector<std::string> &names);
+
+    // Index of name, declaring it as the next variable if it is new
+    std::uint32_t declare(std::string_view name);
+
+    // Index of name, or nullptr if it was never declared
+    const std::uint32_t *find(std::string_view name) const;
+
+    const std::string &name(std::uint32_t index) const { return names[index]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, std::uint32_t> indices;
+};
+
+
+
+#endif // SYMBOLS_HPP
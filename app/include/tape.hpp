@@ -0,0 +1,195 @@
+#ifndef TAPE_HPP
+#define TAPE_HPP
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "interval.hpp"
+
+
+
+// Operation codes of the flat instruction tape
+enum class OpCode : std::uint8_t {
+    Const,  // dst = constants[a]
+    Var,    // dst = vars[a]; x alone is variable 0
+    Add,    // dst = r[a] + r[b]
+    Sub,    // dst = r[a] - r[b]
+    Mul,    // dst = r[a] * r[b]
+    Div,    // dst = r[a] / r[b]
+    Pow,    // dst = r[a] ^ r[b]
+    PowInt, // dst = r[a] ^ n for the integer n with bits b, by repeated squaring
+    Call,   // dst = g(r[a]) for the function g with FuncId b
+    Poly    // dst = p(r[a]) by Horner for the polynomial with coefficients at b (see polyOperand)
+};
+
+
+// The b operand of a Poly instruction: the polynomial's coefficients are
+// constants[offset .. offset + degree]. Degrees stay below 256, offsets below 2^24.
+constexpr std::uint32_t maxPolyOffset = 1u << 24;
+
+inline std::uint32_t polyOperand(std::uint32_t offset, std::uint32_t degree) { return ( offset << 8 ) | degree; }
+inline std::uint32_t polyOffset(std::uint32_t b) { return b >> 8; }
+inline std::uint32_t polyDegree(std::uint32_t b) { return b & 0xffu; }
+
+
+// Number of register operands read by an opcode (PowInt, Call and Poly read only a)
+inline int operandCount(OpCode op) {
+    switch (op) {
+        case OpCode::Const:
+        case OpCode::Var:
+            return 0;
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Mul:
+        case OpCode::Div:
+        case OpCode::Pow:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+
+// Value, first and second derivative at one point (a truncated Taylor jet)
+struct Jet {
+    Complex f;
+    Complex f1;
+    Complex f2;
+};
+
+
+// One tape instruction: opcode + destination and operand register slots
+struct Instruction {
+    OpCode op;
+    std::uint32_t dst;
+    std::uint32_t a;
+    std::uint32_t b;
+};
+
+
+/**
+ * @brief Read-only view of a compiled tape's arrays.
+ *
+ * Evaluates exactly as the Tape it was taken from, but owns nothing: the
+ * arrays may belong to a Tape (Tape::view()) or lie in a memory-mapped
+ * file (see catalog.hpp). They must outlive the view.
+ */
+struct TapeView {
+    const Instruction *code = nullptr;
+    size_t codeSize = 0;
+    const Complex *constants = nullptr;
+    size_t constantCount = 0;
+    const std::uint32_t *results = nullptr;     // Registers holding the outputs
+    size_t outputCount = 0;
+    std::uint32_t registers = 0;
+    std::uint32_t variables = 0;
+
+    const Instruction *begin() const { return code; }
+    const Instruction *end() const { return code + codeSize; }
+
+    // As the Tape members of the same names
+    Complex eval(const Complex &x) const;
+    void evalOutputs(const Complex &x, Complex *out) const;
+    void evalOutputs(const Complex *vars, Complex *out) const;
+    void evalBatch(const Complex *in, Complex *out, size_t n) const;
+
+    template <typename T>
+    std::complex<T> evalAs(const std::complex<T> &x) const;
+
+    template <typename T>
+    void evalBatchAs(const std::complex<T> *in, std::complex<T> *out, size_t n) const;
+
+    // Throws unless the tape reads no variable but x, for the entry points taking x
+    void requireSingleVariable() const;
+};
+
+
+/**
+ * @brief AST compiled into a contiguous instruction tape.
+ *
+ * Every node becomes one instruction writing into a register slot,
+ * nodes shared by pointer are emitted once, and register slots are
+ * reused as soon as their last reader has run. Evaluation is a plain
+ * loop over the tape and gives the same results as Node::eval.
+ * Tapes of expressions in x alone take x itself; a tape with more
+ * variables is only evaluated from a variable vector, by evalOutputs().
+ */
+class Tape {
+public:
+    Tape() = default;
+
+    // Compile a tree (or DAG) into a tape
+    static Tape compile(const NodePtr &tree);
+
+    // Compile several trees into one tape with one output each; nodes
+    // shared between the trees are computed once
+    static Tape compile(const std::vector<NodePtr> &trees);
+
+    // Evaluate the compiled expression at x (the first output)
+    Complex eval(const Complex &x) const;
+
+    // Evaluate all outputs at x: out[i] is the value of the i-th compiled tree
+    void evalOutputs(const Complex &x, Complex *out) const;
+
+    // Same with vars[i] bound to the variable with index i (i < variableCount())
+    void evalOutputs(const Complex *vars, Complex *out) const;
+
+    // out[i] = eval(in[i]) for i < n. Points are processed in blocks of
+    // blockSize, running each instruction over the whole block at once.
+    void evalBatch(const Complex *in, Complex *out, size_t n) const;
+
+    // Same as eval() / evalBatch() in the precision of T (float, double or long double)
+    template <typename T>
+    std::complex<T> evalAs(const std::complex<T> &x) const;
+
+    template <typename T>
+    void evalBatchAs(const std::complex<T> *in, std::complex<T> *out, size_t n) const;
+
+    // Forward-mode evaluation: propagates (u, u', u'') through every
+    // instruction and returns f, f', f'' at x from one pass over the tape
+    Jet evalJet(const Complex &x) const;
+
+    // Arbitrary-order forward mode: coeffs[k] = f^(k)(x) / k! for k <= order, from
+    // one pass propagating truncated Taylor series (O(order^2) per instruction)
+    void evalTaylor(const Complex &x, size_t order, Complex *coeffs) const;
+
+    // Interval forward mode: the evalJet() dataflow in box arithmetic, so
+    // the result contains f, f', f'' at every x in the box (see interval.hpp)
+    BoxJet evalBox(const Box &x) const;
+
+    // Double-precision batch over split real/imaginary arrays, using the simd kernels
+    void evalBatchSoA(const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n) const;
+
+    static constexpr size_t blockSize = 256;
+
+    size_t size() const { return code.size(); }
+    size_t registerCount() const { return registers; }
+    size_t outputCount() const { return results.size(); }
+
+    // One more than the largest variable index read: 1 for a tape in x, 0 for a constant
+    size_t variableCount() const { return variables; }
+
+    // Heap bytes held by the instruction, constant and result arrays
+    size_t memoryBytes() const;
+
+    // View of the arrays, valid while the Tape is alive and unchanged
+    TapeView view() const;
+
+private:
+    std::vector<Instruction> code;
+    std::vector<Complex> constants;
+    std::uint32_t registers = 0;            // Number of register slots needed
+    std::uint32_t variables = 0;            // Length of the variable vector read
+    std::vector<std::uint32_t> results;     // Registers holding the outputs
+
+    // Throws unless the tape reads no variable but x, for the entry points taking x
+    void requireSingleVariable() const;
+
+    friend class AdjointTape;
+};
+
+
+
+#endif // TAPE_HPP
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+/**
+ * @brief Fixed-size pool of worker threads.
+ *
+ * Tasks are taken from one shared FIFO queue. parallelFor() splits a
+ * range into chunks that workers (and the calling thread) claim one at
+ * a time, so faster threads simply take more chunks.
+ */
+class ThreadPool {
+public:
+    // threads == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Queue a task for any worker
+    void submit(std::function<void()> task);
+
+    // Run body(begin, end) over [0, n) in chunks of at most `chunk` items and wait
+    // for all of them. The first exception thrown by body is rethrown here.
+    void parallelFor(size_t n, size_t chunk, const std::function<void(size_t, size_t)> &body);
+
+    size_t size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,56 @@
+#ifndef TOKENIZER_HPP
+#define TOKENIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+
+enum class TokenKind : std::uint8_t {
+    Number,     // [0-9]+ ( "." [0-9]* )?
+    Ident,      // [a-zA-Z] [a-zA-Z0-9_]*
+    Plus, Minus, Star, Slash, Caret,
+    LParen, RParen,
+    Group,      // "(" ... ")" already parsed, in a prepared token stream (see Parser); never from tokenize()
+    End         // One past the last token, at the end of the input
+};
+
+
+// One token; `text` points into the tokenized input, which must outlive it
+struct Token {
+    TokenKind kind;
+    std::string_view text;
+    size_t pos;             // Offset of text in the input
+    double value = 0.0;     // Number tokens only
+    std::uint32_t group = 0;    // Group tokens only: index of the parsed group
+};
+
+
+// Syntax error with the input offset it was detected at
+class ParseError : public std::runtime_error {
+public:
+    ParseError(const std::string &message, size_t pos)
+        : std::runtime_error(message + " at position " + std::to_string(pos)), offset(pos) {}
+
+    size_t position() const { return offset; }
+
+private:
+    size_t offset;
+};
+
+
+// Split input into tokens in one pass, ending with an End token. Numbers
+// are converted with std::from_chars; nothing is copied out of the input.
+std::vector<Token> tokenize(std::string_view input);
+
+// Append the tokens of input[begin, end) to tokens, with offsets in the
+// whole input and no End token; a token never extends past end
+void tokenizeRange(std::string_view input, size_t begin, size_t end, std::vector<Token> &tokens);
+
+
+
+#endif // TOKENIZER_HPP
@@ -10,7 +10,8 @@
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // <constant>  ::= [0-9]+ ( "." [0-9]+ )?
 // <variable>  ::= "x"
-// <func_name> ::= "sin" | "cos" | "tan" | "cot" | "log"
+// <func_name> ::= "sin" | "cos" | "tan" | "cot" | "log" | "exp" | "sqrt"
+//               | "sinh" | "cosh" | "tanh" | "asin" | "acos" | "atan"
 // 
 // <expression> ::= <term> ( ( "+" | "-" ) <term> )*
 // <term>       ::= <factor> ( ( "*" | "/" ) <factor> )*
@@ -53,12 +54,16 @@
 
 
 /*
-1. **Parsing**: Convert the input string into an Abstract Syntax Tree (AST) using a recursive-descent parser.  
-   - The grammar supports constants, variable 'x', function calls ('sin', 'cos', 'tan', 'cot', 'log'), binary operations ('+', '-', '*', '/'), and exponentiation ('^').
+1. **Parsing**: Convert the input string into an Abstract Syntax Tree (AST) using an operator-precedence parser (no recursion, so nesting depth is not limited by the stack).  
+   - The grammar supports constants, variable 'x', function calls ('sin', 'cos', 'tan', 'cot', 'log', 'exp', 'sqrt',
+     'sinh', 'cosh', 'tanh', 'asin', 'acos', 'atan'), binary operations ('+', '-', '*', '/'), and exponentiation ('^').
 
-2. **AST Nodes**: Each node type ('ConstNode', 'VarNode', 'BinaryNode', 'PowerNode', 'FuncNode') implements two methods:
-   - 'eval(x)': Evaluate the expression represented by the subtree for a complex input 'x'.
-   - 'deriv()': Symbolically compute and return a new AST representing the derivative.
+2. **AST Nodes**: Each node type ('ConstNode', 'VarNode', 'BinaryNode', 'PowerNode', 'IntPowerNode', 'FuncNode', 'PolyNode') implements two methods:
+   - 'apply(...)': Its value, given the values of its operands.
+   - 'derivFrom(...)': Its derivative as a new AST, given the derivatives of its operands.
+   'Node::eval(x)' and 'Node::deriv()' walk the tree with explicit stacks and call them.
+   A constant integer exponent is an 'IntPowerNode', evaluated by repeated squaring; x^0.5 is sqrt(x).
+   Polynomial subtrees are collected into a 'PolyNode' of coefficients, evaluated by Horner's rule and differentiated on the coefficients.
 
 3. **Differentiation Rules**:
    - **Linearity**: " (f ± g)' = f' ± g' "
@@ -66,26 +71,85 @@
    - **Quotient Rule**: " (f/g)' = (f'·g - f·g') / g² "
    - **Chain Rule**: " (f∘g)' = f'(g(x)) · g'(x) "
    - **Power Rule (General)**: " d(u^v) = u^v · [v'·ln(u) + v·(u'/u)] "
+   - **Power Rule (Constant exponent)**: " d(u^n) = n · u^(n-1) · u' "
 
-4. **Lambda Wrapping**: After building the AST for f, f', and f", wrap each in a 'std::function<Complex(Complex)>' lambda that invokes 'eval(x)'.  
+4. **Callables**: f, f' and f" share one 'Expression', which builds each AST on first use and compiles it to a tape.
+   'differentiate()' wraps each in a 'std::function<Complex(Complex)>' lambda that invokes 'Expression::eval(order, x)'.
+   main() uses 'differentiateNative()', which compiles them to machine code in the differentiate-jit build
+   and evaluates through the 'Expression' otherwise.
 
 5. **Usage**: 'differentiate(expr)' returns a tuple (f, f', f''), each callable on complex inputs.
+   'differentiateDirect(expr)' returns them as 'ExpressionFunc' structs, called without std::function's indirection.
+
+6. **Several Variables**: 'MultiExpression' (gradient.hpp) reads any name as a variable, numbered by a 'SymbolTable',
+   and evaluates f, its gradient and its Hessian at a point given as a vector; all partials come from adjoint sweeps that share work.
+
+7. **Edited Expressions**: 'IncrementalDifferentiator' (incremental.hpp) takes each new version of an expression and reparses only
+   the text around the edit; unchanged subtrees map to the same hash-consed nodes, whose derivatives and simplified forms are kept.
 */
 
 
 // main.cpp
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 
 #include "differentiator.hpp"
+#include "expression.hpp"
+#include "profile.hpp"
+#include "cache.hpp"
+#include "stream.hpp"
+#include "binary_io.hpp"
+#include "catalog.hpp"
+#include "thread_pool.hpp"
+#include "server.hpp"
 
 
 
 void printUsage();
+void printProfile(const std::string &mathExpr, const Complex &z);
+int runStreamMode(const char *path);
+int runBinaryMode(int argc, char *argv[]);
+int runCatalogMode(int argc, char *argv[]);
+int runBoundMode(int argc, char *argv[]);
+int runServeMode(int argc, char *argv[]);
 
 
 int main(int argc, char *argv[]) {
+    // --stream [file]: bulk records from the file or stdin (see stream.hpp)
+    if ( argc > 1 && std::string(argv[1]) == "--stream" && argc <= 3 ) {
+        return runStreamMode(argc == 3 ? argv[2] : nullptr);
+    }
+
+    // --binary [--long-double] expr in.bin out.bin: raw interleaved points (see binary_io.hpp)
+    if ( argc > 1 && std::string(argv[1]) == "--binary" ) {
+        return runBinaryMode(argc - 2, argv + 2);
+    }
+
+    // --build-catalog list out, --catalog file expr re [im]: precompiled expressions (see catalog.hpp)
+    if ( argc > 1 && ( std::string(argv[1]) == "--build-catalog" || std::string(argv[1]) == "--catalog" ) ) {
+        return runCatalogMode(argc - 1, argv + 1);
+    }
+
+    // --bound expr re_lo re_hi im_lo im_hi: guaranteed ranges of f, f', f'' over a box (see interval.hpp)
+    if ( argc > 1 && std::string(argv[1]) == "--bound" ) {
+        return runBoundMode(argc - 2, argv + 2);
+    }
+
+    // --serve socket [threads]: long-lived server on a Unix socket (see server.hpp)
+    if ( argc > 1 && std::string(argv[1]) == "--serve" ) {
+        return runServeMode(argc - 2, argv + 2);
+    }
+
+    // Optional leading --profile: tree statistics and, in a DIFF_PROFILE build, per-node timings
+    bool profiling = ( argc > 1 && std::string(argv[1]) == "--profile" );
+    if ( profiling ) {
+        --argc;
+        ++argv;
+    }
+
     // Expected: (program, expr, real) or (program, expr, real, imag).
     if ( argc != 3 && argc != 4 ) {
         printUsage();
@@ -105,12 +169,18 @@ int main(int argc, char *argv[]) {
         std::cout << "Point:    z    = " << z << std::endl;
         std::cout << "------------------------------------" << std::endl;
 
-        auto [f, f1, f2] = differentiate(mathExpr);
+        // Native code in the differentiate-jit build, the trees otherwise
+        NativeFuncs funcs = differentiateNative(mathExpr);
+        const Func &f = funcs.f, &f1 = funcs.f1, &f2 = funcs.f2;
         
         // Evaluate and print
         std::cout << "f(z)   = " << f(z) << std::endl;
         std::cout << "f'(z)  = " << f1(z) << std::endl;
         std::cout << "f''(z) = " << f2(z) << std::endl;
+
+        if ( profiling ) {
+            printProfile(mathExpr, z);
+        }
     }
     catch (const std::invalid_argument &e) {
         std::cerr << "Error: Invalid number format for the point. Please provide valid numbers." << std::endl;
@@ -129,8 +199,213 @@ int main(int argc, char *argv[]) {
 
 void printUsage() {
     std::cerr << "Usage:\n"
-              << "  ./differentiate <\"expression\"> <real_part>\n"
-              << "  ./differentiate <\"expression\"> <real_part> <imag_part>\n\n";
+              << "  ./differentiate [--profile] <\"expression\"> <real_part>\n"
+              << "  ./differentiate [--profile] <\"expression\"> <real_part> <imag_part>\n"
+              << "  ./differentiate --stream [file]     (records: '@ <expression>' or 're[,im] ...' per line)\n"
+              << "  ./differentiate --binary [--long-double] <\"expression\"> <in.bin> <out.bin>\n"
+              << "  ./differentiate --build-catalog <expressions.txt> <out.cat>   (one expression per line)\n"
+              << "  ./differentiate --catalog <file.cat> <\"expression\"> <real_part> [imag_part]\n"
+              << "  ./differentiate --bound <\"expression\"> <re_lo> <re_hi> <im_lo> <im_hi>\n"
+              << "  ./differentiate --serve <socket_path> [threads]   (--stream records per connection, '?' for stats)\n\n";
+}
+
+int runBinaryMode(int argc, char *argv[]) {
+    BinaryFormat format = BinaryFormat::Double;
+    if ( argc > 0 && std::string(argv[0]) == "--long-double" ) {
+        format = BinaryFormat::LongDouble;
+        --argc;
+        ++argv;
+    }
+    if ( argc != 3 ) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        DiffOptions options;
+        options.useTape = true;
+        Expression expr(argv[0], options);
+        ThreadPool pool;
+
+        size_t points = evalBinaryFile(expr, argv[1], argv[2], format, pool);
+        std::cerr << points << " points" << std::endl;
+    }
+    catch (const std::runtime_error &e) {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int runStreamMode(const char *path) {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+
+    std::ifstream file;
+    if ( path ) {
+        file.open(path);
+        if ( !file ) {
+            std::cerr << "Error: cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+
+    ExpressionCache cache;
+    StreamStats stats = runStream(path ? file : std::cin, std::cout, cache);
+
+    return stats.errors ? 2 : 0;
+}
+
+// argv[0] is the mode: --build-catalog writes one entry per non-empty line,
+// --catalog evaluates f, f', f'' of an entry straight from the mapped file
+int runCatalogMode(int argc, char *argv[]) {
+    bool build = ( std::string(argv[0]) == "--build-catalog" );
+    if ( build ? argc != 3 : ( argc != 4 && argc != 5 ) ) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        if ( build ) {
+            std::ifstream list(argv[1]);
+            if ( !list ) {
+                std::cerr << "Error: cannot open " << argv[1] << std::endl;
+                return 1;
+            }
+
+            std::vector<std::string> expressions;
+            for ( std::string line; std::getline(list, line); ) {
+                if ( line.find_first_not_of(" \t\r") != std::string::npos )  expressions.push_back(line);
+            }
+
+            Catalog::write(argv[2], expressions);
+            std::cerr << expressions.size() << " expressions" << std::endl;
+            return 0;
+        }
+
+        Catalog catalog(argv[1]);
+        const size_t *entry = catalog.find(argv[2]);
+        if ( !entry ) {
+            std::cerr << "Error: " << argv[2] << " is not in " << argv[1] << std::endl;
+            return 1;
+        }
+
+        Complex z(std::stold(argv[3]), ( argc == 5 ) ? std::stold(argv[4]) : 0.0L);
+        std::cout << "f(z)   = " << catalog.tape(*entry, 0).eval(z) << std::endl;
+        std::cout << "f'(z)  = " << catalog.tape(*entry, 1).eval(z) << std::endl;
+        std::cout << "f''(z) = " << catalog.tape(*entry, 2).eval(z) << std::endl;
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << "Error: Invalid number format for the point. Please provide valid numbers." << std::endl;
+        return 1;
+    }
+    catch (const std::runtime_error &e) {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+Server *activeServer = nullptr;
+
+void stopServer(int) {
+    if ( activeServer )  activeServer -> stop();
+}
+
+// Serves until SIGINT or SIGTERM, then prints the final counters
+int runServeMode(int argc, char *argv[]) {
+    if ( argc != 1 && argc != 2 ) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        ThreadPool pool(( argc == 2 ) ? std::stoul(argv[1]) : 0);
+        ExpressionCache cache;
+        Server server(argv[0], cache, pool);
+
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        std::cerr << "Listening on " << argv[0] << " with " << pool.size() << " workers" << std::endl;
+
+        server.run();
+        activeServer = nullptr;
+        std::cerr << formatStats(server.stats());
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << "Error: Invalid number of threads." << std::endl;
+        return 1;
+    }
+    catch (const std::runtime_error &e) {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+std::ostream &operator<<(std::ostream &out, const Box &box) {
+    return out << "[" << box.re.lo << ", " << box.re.hi << "] + i [" << box.im.lo << ", " << box.im.hi << "]";
+}
+
+// One interval pass over the tape of f; every point of the box has its value inside each printed range
+int runBoundMode(int argc, char *argv[]) {
+    if ( argc != 5 ) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        Expression expr(argv[0]);
+        Box box({ std::stold(argv[1]), std::stold(argv[2]) }, { std::stold(argv[3]), std::stold(argv[4]) });
+        if ( box.re.lo > box.re.hi || box.im.lo > box.im.hi ) {
+            std::cerr << "Error: empty box, each lower bound must not exceed its upper bound" << std::endl;
+            return 1;
+        }
+
+        BoxJet bounds = expr.bound(box);
+        std::cout << "f(box)   in " << bounds.f << std::endl;
+        std::cout << "f'(box)  in " << bounds.f1 << std::endl;
+        std::cout << "f''(box) in " << bounds.f2 << std::endl;
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << "Error: Invalid number format for the box. Please provide valid numbers." << std::endl;
+        return 1;
+    }
+    catch (const std::runtime_error &e) {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Tree size and depth of f, f', f'', then where one tree evaluation of each spends its time
+void printProfile(const std::string &mathExpr, const Complex &z) {
+    const char *names[3] = { "f  ", "f' ", "f''" };
+    Expression expr(mathExpr);
+
+    std::cout << "------------------------------------" << std::endl;
+    for ( int order = 0; order <= 2; ++order ) {
+        profile::TreeStats stats = profile::treeStats(expr.tree(order));
+        std::cout << "Tree " << names[order] << ": " << stats.nodes << " nodes (" << stats.uniqueNodes
+                  << " unique), depth " << stats.depth << std::endl;
+    }
+
+    if ( !profile::enabled() ) {
+        std::cout << "(per-node timings need a DIFF_PROFILE build: make profile)" << std::endl;
+        return;
+    }
+
+    profile::reset();
+    for ( int order = 0; order <= 2; ++order ) {
+        expr.eval(order, z);
+    }
+    std::cout << "------------------------------------" << std::endl;
+    profile::report(std::cout);
 }
 
 
@@ -159,6 +434,7 @@ void printUsage() {
         "x^88.3 / x^81.8 / x",
         "x+cot(89.4*x^(x/62.5^x*36.5^52.5-63/x^37+27.3)+x/x)+99.5/x/(x+x^69.1*(8.4^x*x^37.6/x)/x^sin(57.7^x*x^x+x-x))^x"
         // Expected in z7 = (-1.73, 3): (5.61228e+103,9.20117e+103) (+/- (1.7498e+100,3.4996e+100))
+        // (--bound on the single point z7 encloses f'' in a box about 1e91 wide per component)
     };
 
     for ( const auto &expr : expressions ) {
@@ -0,0 +1,179 @@
+// src/adjoint.cpp
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "adjoint.hpp"
+#include "ast.hpp"
+#include "functions.hpp"
+#include "tape.hpp"
+
+
+
+// Undo the register allocation: an operand slot names the value last
+// written to it, so replaying the writes gives every operand its value id.
+// Instructions after the output's do not contribute to it and are dropped.
+AdjointTape::AdjointTape(const Tape &tape, size_t output) : constants(tape.constants), variables(tape.variables) {
+    if ( output >= tape.results.size() ) {
+        throw std::runtime_error("Tape has no such output");
+    }
+
+    std::vector<std::uint32_t> writer(tape.registers, 0);
+
+    code.reserve(tape.code.size());
+    varying.reserve(tape.code.size());
+
+    for ( size_t i = 0; i < tape.code.size(); ++i ) {
+        Instruction instr = tape.code[i];
+        int n = operandCount(instr.op);
+
+        if ( n >= 1 )  instr.a = writer[instr.a];
+        if ( n >= 2 )  instr.b = writer[instr.b];
+
+        bool depends = ( instr.op == OpCode::Var )
+                    || ( n >= 1 && varying[instr.a] )
+                    || ( n >= 2 && varying[instr.b] );
+
+        writer[instr.dst] = static_cast<std::uint32_t>(i);
+        instr.dst = static_cast<std::uint32_t>(i);
+
+        code.push_back(instr);
+        varying.push_back(depends);
+    }
+
+    // Output slots are never reused, so the last write is the output's value
+    result = writer[tape.results[output]];
+    code.resize(result + 1);
+    varying.resize(result + 1);
+    values.resize(code.size());
+    adjoints.resize(code.size());
+}
+
+Complex AdjointTape::gradient(const Complex *vars, Complex *grad) {
+    // Forward: the values every partial below is taken at
+    for ( const Instruction &instr : code ) {
+        Complex &d = values[instr.dst];
+
+        // Const and Var read no value: their a indexes constants or vars
+        if ( instr.op == OpCode::Const ) {
+            d = constants[instr.a];
+            continue;
+        }
+        if ( instr.op == OpCode::Var ) {
+            d = vars[instr.a];
+            continue;
+        }
+
+        // b is a value only for two-operand opcodes (operandCount)
+        const Complex &a = values[instr.a];
+        const Complex &b = values[operandCount(instr.op) == 2 ? instr.b : instr.a];
+
+        switch (instr.op) {
+            case OpCode::Const:
+            case OpCode::Var:   break;
+            case OpCode::Add:   d = a + b; break;
+            case OpCode::Sub:   d = a - b; break;
+            case OpCode::Mul:   d = a * b; break;
+            case OpCode::Div:   d = a / b; break;
+            case OpCode::Pow:   d = std::pow(a, b); break;
+            case OpCode::PowInt: d = powInt(a, static_cast<std::int32_t>(instr.b)); break;
+            case OpCode::Call:  d = applyFunc(static_cast<FuncId>(instr.b), a); break;
+            case OpCode::Poly:  d = horner(constants.data() + polyOffset(instr.b), polyDegree(instr.b), a); break;
+        }
+    }
+
+    // Reverse: every user comes after its operands, so adjoints[i] is
+    // complete when instruction i is reached
+    const Complex zero(0.0), one(1.0);
+    std::fill(adjoints.begin(), adjoints.end(), zero);
+    std::fill(grad, grad + variables, zero);
+    adjoints[result] = one;
+
+    for ( size_t i = code.size(); i-- > 0; ) {
+        const Complex adjoint = adjoints[i];
+        if ( !varying[i] || adjoint == zero ) {
+            continue;
+        }
+
+        const Instruction &instr = code[i];
+        if ( instr.op == OpCode::Var ) {
+            grad[instr.a] += adjoint;
+            continue;
+        }
+
+        // Const is never varying, so every instruction here reads a value
+        const Complex &a = values[instr.a];
+        const Complex &b = values[operandCount(instr.op) == 2 ? instr.b : instr.a];
+
+        switch (instr.op) {
+            case OpCode::Const:
+            case OpCode::Var:
+                break;
+            case OpCode::Add:
+                adjoints[instr.a] += adjoint;
+                adjoints[instr.b] += adjoint;
+                break;
+            case OpCode::Sub:
+                adjoints[instr.a] += adjoint;
+                adjoints[instr.b] -= adjoint;
+                break;
+            case OpCode::Mul:
+                adjoints[instr.a] += adjoint * b;
+                adjoints[instr.b] += adjoint * a;
+                break;
+            case OpCode::Div:
+                // d(a/b)/da = 1/b, d(a/b)/db = -(a/b)/b
+                adjoints[instr.a] += adjoint / b;
+                adjoints[instr.b] -= adjoint * values[i] / b;
+                break;
+            case OpCode::Pow:
+                // Power rule v u^(v-1) for a constant exponent, as PowerNode::derivFrom;
+                // u^v (v/u) and u^v ln(u) otherwise
+                if ( varying[instr.a] ) {
+                    adjoints[instr.a] += varying[instr.b] ? adjoint * values[i] * ( b / a )
+                                                          : adjoint * b * std::pow(a, b - one);
+                }
+                if ( varying[instr.b] ) {
+                    adjoints[instr.b] += adjoint * values[i] * std::log(a);
+                }
+                break;
+            case OpCode::PowInt: {
+                auto p = static_cast<std::int32_t>(instr.b);
+                if ( p != 0 ) {
+                    adjoints[instr.a] += adjoint * Complex(p) * powInt(a, p - 1);
+                }
+                break;
+            }
+            case OpCode::Call: {
+                Complex g, d1, d2;
+                funcInfo(static_cast<FuncId>(instr.b)).jet(a, g, d1, d2);
+                adjoints[instr.a] += adjoint * d1;
+                break;
+            }
+            case OpCode::Poly: {
+                // p'(a) on the differentiated coefficients
+                const Complex *c = constants.data() + polyOffset(instr.b);
+                size_t degree = polyDegree(instr.b);
+                if ( degree > 0 ) {
+                    Complex d1 = c[degree] * static_cast<long double>(degree);
+                    for ( size_t k = degree - 1; k > 0; --k ) {
+                        d1 = d1 * a + c[k] * static_cast<long double>(k);
+                    }
+                    adjoints[instr.a] += adjoint * d1;
+                }
+                break;
+            }
+        }
+    }
+
+    return values[result];
+}
+
+size_t AdjointTape::memoryBytes() const {
+    return code.capacity() * sizeof(Instruction)
+         + constants.capacity() * sizeof(Complex)
+         + varying.capacity()
+         + ( values.capacity() + adjoints.capacity() ) * sizeof(Complex);
+}
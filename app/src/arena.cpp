@@ -0,0 +1,50 @@
+// src/arena.cpp
+#include <cstdint>
+#include <stdexcept>
+
+#include "arena.hpp"
+
+
+
+namespace {
+
+thread_local NodeArena *activeArena = nullptr;
+
+} // namespace
+
+
+
+NodeArena::~NodeArena() {
+    // Children are non-owning inside the arena, so this never recurses
+    for ( auto it = nodes.rbegin(); it != nodes.rend(); ++it ) {
+        (*it) -> ~Node();
+    }
+}
+
+void *NodeArena::allocate(size_t size, size_t align) {
+    if ( size > blockBytes ) {
+        throw std::runtime_error("Arena allocation larger than a block");
+    }
+
+    size_t offset = (used + align - 1) & ~(align - 1);
+    if ( offset + size > blockBytes ) {
+        blocks.emplace_back(new unsigned char[blockBytes]);
+        offset = 0;
+    }
+    used = offset + size;
+
+    return blocks.back().get() + offset;
+}
+
+
+ArenaScope::ArenaScope(NodeArena &arena) : previous(activeArena) {
+    activeArena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+    activeArena = previous;
+}
+
+NodeArena *currentArena() {
+    return activeArena;
+}
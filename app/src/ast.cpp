@@ -1,35 +1,341 @@
 // src/ast.cpp
+#include <cmath>
 #include <complex>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
 #include <stdexcept>
 
 #include "ast.hpp"
+#include "arena.hpp"
+#include "functions.hpp"
+#include "profile.hpp"
+
+
+
+namespace {
+
+// Drops one owner of a child. The last owner of a node hands it to a
+// per-thread queue drained by the outermost call, so destroying a deep
+// chain of nodes runs one destructor at a time instead of nesting them.
+// Arena nodes have no owners and are left to their arena.
+void release(NodePtr &child) {
+    thread_local std::vector<NodePtr> pending;
+    thread_local bool draining = false;
+
+    if ( child.use_count() != 1 ) {
+        child.reset();
+        return;
+    }
+
+    pending.push_back(std::move(child));
+    if ( draining ) {
+        return;
+    }
+
+    draining = true;
+    while ( !pending.empty() ) {
+        NodePtr node = std::move(pending.back());
+        pending.pop_back();
+        node.reset();   // Queues the node's own children
+    }
+    draining = false;
+}
+
+// Node -> derivative memo of deriv(). Open addressing over a power-of-two
+// table, since deriv() runs for every order built and a node-keyed
+// std::unordered_map allocates once per entry.
+class DerivMemo {
+public:
+    DerivMemo() : slots(64), zero(makeNode<ConstNode>(0.0)), one(makeNode<ConstNode>(1.0)) {}
+
+    const NodePtr *find(const Node *node) const {
+        for ( size_t i = index(node); ; i = ( i + 1 ) & ( slots.size() - 1 ) ) {
+            if ( slots[i].key == node )  return &slots[i].value;
+            if ( !slots[i].key )  return nullptr;
+        }
+    }
+
+    // Constant subtrees are never walked: their derivative is one shared zero
+    const NodePtr &at(const Node *node) const {
+        return node -> constant ? zero : *find(node);
+    }
+
+    // dx_i/dx_j, shared by every occurrence of a variable
+    const NodePtr &unit(bool same) const {
+        return same ? one : zero;
+    }
+
+    void insert(const Node *node, NodePtr value) {
+        if ( 2 * ( used + 1 ) > slots.size() ) {
+            grow();
+        }
+        place(node, std::move(value));
+    }
+
+private:
+    struct Slot {
+        const Node *key = nullptr;
+        NodePtr value;
+    };
+
+    std::vector<Slot> slots;
+    size_t used = 0;
+    NodePtr zero;
+    NodePtr one;
+
+    size_t index(const Node *node) const {
+        auto bits = reinterpret_cast<std::uintptr_t>(node);
+        return static_cast<size_t>(( bits >> 4 ) * 0x9e3779b97f4a7c15ULL >> 32) & ( slots.size() - 1 );
+    }
+
+    void place(const Node *node, NodePtr value) {
+        size_t i = index(node);
+        while ( slots[i].key ) {
+            i = ( i + 1 ) & ( slots.size() - 1 );
+        }
+        slots[i].key = node;
+        slots[i].value = std::move(value);
+        ++used;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        used = 0;
+        for ( Slot &slot : old ) {
+            if ( slot.key )  place(slot.key, std::move(slot.value));
+        }
+    }
+};
+
+// Derivative of one node from the derivatives of its operands
+NodePtr derivOf(const Node &node, std::uint32_t var, const DerivMemo &derivs) {
+    switch (node.kind) {
+        case Node::Kind::Const:
+            return static_cast<const ConstNode &>(node).derivFrom();
+        case Node::Kind::Var:
+            return derivs.unit(static_cast<const VarNode &>(node).index == var);
+        case Node::Kind::Binary: {
+            auto &binary = static_cast<const BinaryNode &>(node);
+            return binary.derivFrom(derivs.at(binary.left.get()), derivs.at(binary.right.get()));
+        }
+        case Node::Kind::Power: {
+            auto &power = static_cast<const PowerNode &>(node);
+            return power.derivFrom(derivs.at(power.base.get()), derivs.at(power.exp.get()));
+        }
+        case Node::Kind::IntPower: {
+            auto &power = static_cast<const IntPowerNode &>(node);
+            return power.derivFrom(derivs.at(power.base.get()));
+        }
+        case Node::Kind::Func: {
+            auto &func = static_cast<const FuncNode &>(node);
+            return func.derivFrom(derivs.at(func.arg.get()));
+        }
+        case Node::Kind::Poly: {
+            auto &poly = static_cast<const PolyNode &>(node);
+            return poly.derivFrom(derivs.at(poly.arg.get()));
+        }
+    }
+
+    throw std::runtime_error("Unknown node kind");
+}
+
+} // namespace
+
+
+
+// Iterative post-order: descend along first operands pushing one frame per
+// inner node, then climb back, either turning to a node's second operand
+// (parking the first one's value in the frame) or combining the operand values
+Complex Node::eval(const Complex *vars) const {
+    struct Frame {
+        const Node *node;
+        bool second;        // Now evaluating the second operand
+        Complex first;      // Value of the first operand, once second
+    };
+
+    // Scratch reused across calls on this thread; a call only works above
+    // the size it found, so a nested call cannot disturb an outer one
+    thread_local std::vector<Frame> threadFrames;
+    std::vector<Frame> &frames = threadFrames;
+
+    const size_t base = frames.size();
+    const Node *node = this;
+    Complex value;
+
+    for (;;) {
+        // Descend to the leftmost leaf below node
+        for (;;) {
+            if ( node -> kind == Kind::Binary ) {
+                frames.push_back({ node, false, Complex() });
+                node = static_cast<const BinaryNode *>(node) -> left.get();
+            }
+            else if ( node -> kind == Kind::Power ) {
+                frames.push_back({ node, false, Complex() });
+                node = static_cast<const PowerNode *>(node) -> base.get();
+            }
+            else if ( node -> kind == Kind::IntPower ) {
+                frames.push_back({ node, false, Complex() });
+                node = static_cast<const IntPowerNode *>(node) -> base.get();
+            }
+            else if ( node -> kind == Kind::Func ) {
+                frames.push_back({ node, false, Complex() });
+                node = static_cast<const FuncNode *>(node) -> arg.get();
+            }
+            else if ( node -> kind == Kind::Poly ) {
+                frames.push_back({ node, false, Complex() });
+                node = static_cast<const PolyNode *>(node) -> arg.get();
+            }
+            else {
+                break;
+            }
+        }
+
+        if ( node -> kind == Kind::Const ) {
+            DIFF_PROFILE_EVAL(profile::Const);
+            value = static_cast<const ConstNode *>(node) -> apply();
+        }
+        else {
+            DIFF_PROFILE_EVAL(profile::Var);
+            value = static_cast<const VarNode *>(node) -> apply(vars);
+        }
+
+        // Climb while nodes are complete; stop at the next second operand
+        node = nullptr;
+        while ( frames.size() > base && !node ) {
+            Frame &frame = frames.back();
+
+            switch (frame.node -> kind) {
+                case Kind::Binary: {
+                    auto binary = static_cast<const BinaryNode *>(frame.node);
+                    if ( !frame.second ) {
+                        frame.second = true;
+                        frame.first = value;
+                        node = binary -> right.get();
+                        continue;
+                    }
+
+                    DIFF_PROFILE_EVAL(profile::binarySlot(binary -> op));
+                    value = binary -> apply(frame.first, value);
+                    break;
+                }
+                case Kind::Power: {
+                    auto power = static_cast<const PowerNode *>(frame.node);
+                    if ( !frame.second ) {
+                        frame.second = true;
+                        frame.first = value;
+                        node = power -> exp.get();
+                        continue;
+                    }
+
+                    DIFF_PROFILE_EVAL(profile::Pow);
+                    value = power -> apply(frame.first, value);
+                    break;
+                }
+                case Kind::IntPower: {
+                    DIFF_PROFILE_EVAL(profile::Pow);
+                    value = static_cast<const IntPowerNode *>(frame.node) -> apply(value);
+                    break;
+                }
+                case Kind::Poly: {
+                    DIFF_PROFILE_EVAL(profile::Poly);
+                    value = static_cast<const PolyNode *>(frame.node) -> apply(value);
+                    break;
+                }
+                default: {
+                    auto func = static_cast<const FuncNode *>(frame.node);
+                    DIFF_PROFILE_EVAL(profile::funcSlot(func -> func));
+                    value = func -> apply(value);
+                    break;
+                }
+            }
+
+            frames.pop_back();
+        }
+
+        if ( !node ) {
+            return value;
+        }
+    }
+}
+
+// Memoized post-order walk: operand derivatives are built before the node's.
+// Constant subtrees count as done, so the walk never descends into them.
+NodePtr Node::deriv(std::uint32_t var) const {
+    if ( constant ) {
+        return makeNode<ConstNode>(0.0);
+    }
+
+    NodePtr root(NodePtr(), const_cast<Node *>(this));   // Non-owning, only read by the walk
+    DerivMemo derivs;
+
+    postOrder(root,
+        [&](const Node *node) { return node -> constant || derivs.find(node) != nullptr; },
+        [&](const NodePtr &node) { derivs.insert(node.get(), derivOf(*node, var, derivs)); });
+
+    return derivs.at(this);
+}
+
+
+struct DerivCache::Memo {
+    DerivMemo derivs;
+    std::vector<NodePtr> inputs;    // Keeps the keys of derivs alive
+    size_t size = 0;
+};
+
+DerivCache::DerivCache(std::uint32_t v) : memo(std::make_unique<Memo>()), var(v) {}
+
+DerivCache::~DerivCache() = default;
+
+size_t DerivCache::size() const {
+    return memo -> size;
+}
+
+// Node::deriv() over the kept memo
+NodePtr DerivCache::deriv(const NodePtr &tree) {
+    DerivMemo &derivs = memo -> derivs;
+    if ( const NodePtr *known = derivs.find(tree.get()) ) {
+        return *known;
+    }
+    memo -> inputs.push_back(tree);
+
+    postOrder(tree,
+        [&](const Node *node) { return node -> constant || derivs.find(node) != nullptr; },
+        [&](const NodePtr &node) {
+            derivs.insert(node.get(), derivOf(*node, var, derivs));
+            ++memo -> size;
+        });
+
+    return derivs.at(tree.get());
+}
 
 
 
 // <constant>  ::= [0-9]+ ( "." [0-9]+ )?
 // ConstNode constructor
-ConstNode::ConstNode(long double v) : value(v) {}
+ConstNode::ConstNode(const Complex &v) : Node(Kind::Const, true), value(v) {}
 
-Complex ConstNode::eval(const Complex &/*x*/) const {
-    return Complex(value, 0.0);
+Complex ConstNode::apply() const {
+    return value;
 }
 
-NodePtr ConstNode::deriv() const {
-    return std::make_shared<ConstNode>(0.0);
+NodePtr ConstNode::derivFrom() const {
+    return makeNode<ConstNode>(0.0);
 }
 
 
-// Node for variable 'x' representation
+// Node for a variable, 'x' or a named one
 // <variable>  ::= "x"
-Complex VarNode::eval(const Complex &x) const {
-    return x;
+VarNode::VarNode(std::uint32_t i) : Node(Kind::Var, false), index(i) {}
+
+Complex VarNode::apply(const Complex *vars) const {
+    return vars[index];
 }
 
-NodePtr VarNode::deriv() const {
-    return std::make_shared<ConstNode>(1.0);
+NodePtr VarNode::derivFrom(std::uint32_t var) const {
+    return makeNode<ConstNode>(index == var ? 1.0 : 0.0);
 }
 
 
@@ -37,13 +343,15 @@ NodePtr VarNode::deriv() const {
 
 // Binary operations: +, -, *, /
 // BinaryNode constructor
-BinaryNode::BinaryNode(char o, NodePtr l, NodePtr r) : op(o), left(std::move(l)), right(std::move(r)) {}
+BinaryNode::BinaryNode(char o, NodePtr l, NodePtr r) : Node(Kind::Binary, l -> constant && r -> constant), op(o), left(std::move(l)), right(std::move(r)) {}
 
-// Evaluate by computing left and right, then apply op
-Complex BinaryNode::eval(const Complex &x) const {
-    Complex a = left -> eval(x); 
-    Complex b = right -> eval(x);
-    
+BinaryNode::~BinaryNode() {
+    release(left);
+    release(right);
+}
+
+// Apply op to the values of left and right
+Complex BinaryNode::apply(const Complex &a, const Complex &b) const {
     switch (op) {
         case '+': return a + b;
         case '-': return a - b;
@@ -55,25 +363,25 @@ Complex BinaryNode::eval(const Complex &x) const {
 }
 
 // Compute derivative via linearity, product rule, or quotient rule
-NodePtr BinaryNode::deriv() const {
+NodePtr BinaryNode::derivFrom(const NodePtr &dl, const NodePtr &dr) const {
     if ( op == '+' || op == '-' ) {
         // (f ± g)' = f' ± g'
-        return std::make_shared<BinaryNode>(op, left -> deriv(), right -> deriv());
+        return makeNode<BinaryNode>(op, dl, dr);
     } 
     else if ( op == '*' ) {
         // (f * g)' = f'*g + f*g'
-        return std::make_shared<BinaryNode>('+',
-                std::make_shared<BinaryNode>('*', left -> deriv(), right),
-                std::make_shared<BinaryNode>('*', left, right -> deriv()));
+        return makeNode<BinaryNode>('+',
+                makeNode<BinaryNode>('*', dl, right),
+                makeNode<BinaryNode>('*', left, dr));
     } 
     else if ( op == '/' ) {
         // (f / g)' = (f'*g - f*g') / g^2
-        auto num = std::make_shared<BinaryNode>('-',
-                    std::make_shared<BinaryNode>('*', left -> deriv(), right),
-                    std::make_shared<BinaryNode>('*', left, right -> deriv()));
-        auto den = std::make_shared<PowerNode>(right, std::make_shared<ConstNode>(2.0));
+        auto num = makeNode<BinaryNode>('-',
+                    makeNode<BinaryNode>('*', dl, right),
+                    makeNode<BinaryNode>('*', left, dr));
+        auto den = makePower(right, makeNode<ConstNode>(2.0));
         
-        return std::make_shared<BinaryNode>('/', num, den);
+        return makeNode<BinaryNode>('/', std::move(num), std::move(den));
     }
 
     throw std::runtime_error("Unknown binary deriv op");
@@ -82,100 +390,152 @@ NodePtr BinaryNode::deriv() const {
 
 
 // Exponentiation constructor
-PowerNode::PowerNode(NodePtr b, NodePtr e) : base(std::move(b)), exp(std::move(e)) {}
-
-// Evaluate u(x)^v(x) using std::pow for complexes
-Complex PowerNode::eval(const Complex &x) const  {
-    Complex baseVal = Complex(base -> eval(x));
-    Complex expVal = Complex(exp -> eval(x));
+PowerNode::PowerNode(NodePtr b, NodePtr e) : Node(Kind::Power, b -> constant && e -> constant), base(std::move(b)), exp(std::move(e)) {}
 
-    return std::pow(baseVal, expVal);
+PowerNode::~PowerNode() {
+    release(base);
+    release(exp);
+}
 
+// Evaluate u(x)^v(x) using std::pow for complexes
+Complex PowerNode::apply(const Complex &u, const Complex &v) const  {
+    return std::pow(u, v);
 }
 
 // Derivative: d(u^v) = u^v * [v'*ln(u) + v*(u'/u)]
-NodePtr PowerNode::deriv() const {
+NodePtr PowerNode::derivFrom(const NodePtr &du, const NodePtr &dv) const {
     // u(x), v(x)   u^v
-    NodePtr u = base;
-    NodePtr v = exp;
+    const NodePtr &u = base;
+    const NodePtr &v = exp;
+
+    // Constant exponent (v' = 0): the v'*ln(u) term vanishes and u^v * v*(u'/u)
+    // is the power rule v * u^(v-1) * u', which needs neither log nor division
+    auto vConst = dynamic_cast<const ConstNode *>(dv.get());
+    if ( vConst && vConst -> value == 0.0L ) {
+        auto c = dynamic_cast<const ConstNode *>(v.get());
+        NodePtr exponent = c ? makeNode<ConstNode>(c -> value - 1.0L)
+                             : makeNode<BinaryNode>('-', v, makeNode<ConstNode>(1.0));
+
+        return makeNode<BinaryNode>('*', makeNode<BinaryNode>('*', v, makePower(u, std::move(exponent))), du);
+    }
 
-    // Compute derivatives u'(x) and v'(x)
-    NodePtr uDeriv = u -> deriv();
-    NodePtr vDeriv = v -> deriv();
+    // term2 = v(x) * (u'(x) / u(x))
+    NodePtr quotient = makeNode<BinaryNode>('/', du, u);
+    NodePtr term2 = makeNode<BinaryNode>('*', v, std::move(quotient));
 
     // term1 = v'(x) * ln(u(x))
-    auto ln_u = std::make_shared<FuncNode>("log", std::vector<NodePtr>{u});
-    NodePtr term1 = std::make_shared<BinaryNode>('*', vDeriv, ln_u);
-
-    // term2 = v(x) * (u'(x) / u(x))
-    NodePtr quotient = std::make_shared<BinaryNode>('/', uDeriv, u);
-    NodePtr term2 = std::make_shared<BinaryNode>('*', v, quotient);
+    auto ln_u = makeNode<FuncNode>(FuncId::Log, u);
+    NodePtr term1 = makeNode<BinaryNode>('*', dv, std::move(ln_u));
 
     // Sum inside brackets: sumInside = term1 + term1
-    NodePtr sumInsideBrackets = std::make_shared<BinaryNode>('+', term1, term2);
+    NodePtr sumInsideBrackets = makeNode<BinaryNode>('+', std::move(term1), std::move(term2));
 
     // Final derivative: u^v * sumInsideBrackets
-    return std::make_shared<BinaryNode>('*', std::make_shared<PowerNode>(u, v), sumInsideBrackets);
+    return makeNode<BinaryNode>('*', makeNode<PowerNode>(u, v), std::move(sumInsideBrackets));
+}
+
+
+
+// Integer power constructor
+IntPowerNode::IntPowerNode(NodePtr b, std::int32_t e) : Node(Kind::IntPower, b -> constant), base(std::move(b)), n(e) {}
+
+IntPowerNode::~IntPowerNode() {
+    release(base);
+}
+
+Complex IntPowerNode::apply(const Complex &u) const {
+    return powInt(u, n);
+}
+
+// Power rule: d(u^n) = n * u^(n-1) * u', with u^1 = u and u^0 = 1 written out
+NodePtr IntPowerNode::derivFrom(const NodePtr &du) const {
+    if ( n == 0 ) {
+        return makeNode<ConstNode>(0.0);
+    }
+
+    NodePtr factor = makeNode<ConstNode>(static_cast<long double>(n));
+    if ( n != 1 ) {
+        NodePtr lower = ( n == 2 ) ? base : makeNode<IntPowerNode>(base, n - 1);
+        factor = makeNode<BinaryNode>('*', std::move(factor), std::move(lower));
+    }
+
+    return makeNode<BinaryNode>('*', std::move(factor), du);
+}
+
+
+// Pick the cheapest node that evaluates base^exp
+NodePtr makePower(NodePtr base, NodePtr exp) {
+    auto c = dynamic_cast<const ConstNode *>(exp.get());
+    if ( c && c -> value.imag() == 0.0 ) {
+        long double e = c -> value.real();
+
+        if ( std::trunc(e) == e && std::fabs(e) <= IntPowerNode::maxExponent ) {
+            return makeNode<IntPowerNode>(std::move(base), static_cast<std::int32_t>(e));
+        }
+        if ( e == 0.5 ) {
+            return makeNode<FuncNode>(FuncId::Sqrt, std::move(base));
+        }
+    }
+
+    return makeNode<PowerNode>(std::move(base), std::move(exp));
 }
 
+// An x-independent subtree evaluates to the same value at every point,
+// so evaluating it once (at 0) gives its value
+NodePtr foldConstant(NodePtr node) {
+    if ( !node -> constant || node -> kind == Node::Kind::Const ) {
+        return node;
+    }
+    return makeNode<ConstNode>(node -> eval(Complex(0.0, 0.0)));
+}
+
+
 
+// Function calls (sin, cos, tan, cot, log, exp, sqrt, ...)
+// Constructor  -   func(arg)
+FuncNode::FuncNode(FuncId f, NodePtr a) : Node(Kind::Func, a -> constant), func(f), arg(std::move(a)) {}
 
-// Function calls (sin, cos, tan, cot, log)
-// Constructor  -   name(arg)
-FuncNode::FuncNode(std::string nm, std::vector<NodePtr> arg) : name(std::move(nm)), args(std::move(arg)) {}
+FuncNode::~FuncNode() {
+    release(arg);
+}
     
 // Evaluation by function
-// <func_name> ::= "sin" | "cos" | "tan" | "cot" | "log"
-Complex FuncNode::eval(const Complex &x) const {
-    auto v = args[0] -> eval(x);
-
-    if ( name == "sin" )  return std::sin(v);
-    if ( name == "cos" )  return std::cos(v);
-    if ( name == "tan" )  return std::tan(v);
-    if ( name == "cot" )  return Complex(1.0) / std::tan(v);
-    if ( name == "log" )  return std::log(v);
-    
-    throw std::runtime_error("Unknown func: " + name);
+Complex FuncNode::apply(const Complex &a) const {
+    return applyFunc(func, a);
 }
 
 // Compute derivative via chain rule: f'(g) = f'_outer * g'
 // (f∘inner)' = f'_outer(inner) * inner'
-NodePtr FuncNode::deriv() const {
-    // Retrieve inner function and its derivative
-    NodePtr innerFunction = args[0]; 
-    NodePtr innerDerivative = innerFunction -> deriv(); 
-    NodePtr outerDerivative;
-    
-    if ( name == "sin" ) {
-        // Outer derivative: d/dz sin(z) = cos(z)
-        outerDerivative = std::make_shared<FuncNode>("cos", std::vector<NodePtr>{innerFunction});
-    } 
-    else if ( name == "cos" ) {
-        // Outer derivative: d/dz cos(z) = -sin(z)
-        NodePtr sinNode = std::make_shared<FuncNode>("sin", std::vector<NodePtr>{innerFunction});
-        outerDerivative = std::make_shared<BinaryNode>('*', std::make_shared<ConstNode>(-1.0), sinNode);
-    } 
-    else if ( name == "tan" ) {
-        // Outer derivative: d/dz tan(z) = 1 / cos(z)^2
-        NodePtr cosNode = std::make_shared<FuncNode>("cos", std::vector<NodePtr>{innerFunction});
-        NodePtr cosSquared = std::make_shared<PowerNode>(cosNode, std::make_shared<ConstNode>(2.0));
-        outerDerivative = std::make_shared<BinaryNode>('/', std::make_shared<ConstNode>(1.0), cosSquared);
-    } 
-    else if ( name == "cot" ) {
-        // Outer derivative: d/dz cot(z) = -1 / sin(z)^2
-        NodePtr sinNode = std::make_shared<FuncNode>("sin", std::vector<NodePtr>{innerFunction});
-        NodePtr sinSquared = std::make_shared<PowerNode>(sinNode, std::make_shared<ConstNode>(2.0));
-        NodePtr reciprocal = std::make_shared<BinaryNode>('/', std::make_shared<ConstNode>(1.0), sinSquared);
-        outerDerivative = std::make_shared<BinaryNode>('*', std::make_shared<ConstNode>(-1.0), reciprocal);
-    } 
-    else if ( name == "log" ) {
-        // Outer derivative: d/dz log(z) = 1 / z
-        outerDerivative = std::make_shared<BinaryNode>('/', std::make_shared<ConstNode>(1.0), innerFunction);
-    } 
-    else 
-        throw std::runtime_error("Unknown func deriv: "+name);
+NodePtr FuncNode::derivFrom(const NodePtr &darg) const {
+    // Outer derivative from the registry, evaluated at the inner function
+    NodePtr outerDerivative = funcInfo(func).deriv(arg);
     
     // Chain rule: outer(g) * g'
     // f'(x) = outerDerivative(inner(x)) * innerDerivative(x)
-    return std::make_shared<BinaryNode>('*', outerDerivative, innerDerivative);
-}
\ No newline at end of file
+    return makeNode<BinaryNode>('*', std::move(outerDerivative), darg);
+}
+
+
+// Polynomials in one argument
+PolyNode::PolyNode(NodePtr a, std::vector<Complex> c) : Node(Kind::Poly, a -> constant), arg(std::move(a)), coeffs(std::move(c)) {}
+
+PolyNode::~PolyNode() {
+    release(arg);
+}
+
+Complex PolyNode::apply(const Complex &u) const {
+    return horner(coeffs.data(), degree(), u);
+}
+
+// p(u)' = p'(u) * u', where p' comes straight from the coefficients. A
+// linear p has a constant p'; u' = 1 (u is the variable) needs no product.
+NodePtr PolyNode::derivFrom(const NodePtr &darg) const {
+    std::vector<Complex> d = derivCoeffs(coeffs.data(), degree());
+    NodePtr outer = ( d.size() == 1 ) ? makeNode<ConstNode>(d[0]) : makeNode<PolyNode>(arg, std::move(d));
+
+    auto c = dynamic_cast<const ConstNode *>(darg.get());
+    if ( c && c -> value == 1.0L ) {
+        return outer;
+    }
+    return makeNode<BinaryNode>('*', std::move(outer), darg);
+}
@@ -0,0 +1,62 @@
+// src/binary_io.cpp
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "expression.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+
+
+namespace {
+
+// Interleaved (re, im) pairs have exactly the layout of std::complex<T> arrays
+template <typename T>
+size_t evalMapped(const Expression &expr, const MappedFile &input, MappedFile &output, ThreadPool &pool) {
+    using C = std::complex<T>;
+
+    const size_t n = input.size() / sizeof(C);
+    const C *in = static_cast<const C *>(input.data());
+    C *out = static_cast<C *>(output.data());
+
+    pool.parallelFor(n, Expression::parallelChunk, [&](size_t begin, size_t end) {
+        thread_local std::vector<C> values;
+        size_t m = end - begin;
+        values.resize(m);
+
+        for ( int order = 0; order <= 2; ++order ) {
+            expr.evalBatchAs<T>(order, in + begin, values.data(), m);
+
+            for ( size_t j = 0; j < m; ++j ) {
+                out[3 * (begin + j) + order] = values[j];
+            }
+        }
+    });
+
+    return n;
+}
+
+} // namespace
+
+
+
+size_t evalBinaryFile(const Expression &expr, const std::string &inPath, const std::string &outPath,
+                      BinaryFormat format, ThreadPool &pool) {
+    const size_t pointBytes = ( format == BinaryFormat::Double ) ? sizeof(std::complex<double>) : sizeof(Complex);
+
+    MappedFile input = MappedFile::openRead(inPath);
+    if ( input.size() % pointBytes != 0 ) {
+        throw std::runtime_error(inPath + ": size is not a multiple of " + std::to_string(pointBytes) + " bytes");
+    }
+
+    MappedFile output = MappedFile::create(outPath, 3 * input.size());
+
+    if ( format == BinaryFormat::Double ) {
+        return evalMapped<double>(expr, input, output, pool);
+    }
+    return evalMapped<long double>(expr, input, output, pool);
+}
@@ -0,0 +1,149 @@
+// src/cache.cpp
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cache.hpp"
+#include "expression.hpp"
+
+
+
+namespace {
+
+bool isTokenChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '.';
+}
+
+} // namespace
+
+
+
+ExpressionCache::ExpressionCache(size_t cap, size_t bytes, const DiffOptions &opts)
+    : capacity(cap), maxBytes(bytes), options(opts) {}
+
+std::string ExpressionCache::normalize(const std::string &mathExpr) {
+    std::string key;
+    key.reserve(mathExpr.size());
+    bool pendingSpace = false;
+
+    for ( char c : mathExpr ) {
+        if ( std::isspace(static_cast<unsigned char>(c)) ) {
+            pendingSpace = true;
+            continue;
+        }
+
+        // "1 2" or "si n" must not turn into a different, valid expression
+        if ( pendingSpace && !key.empty() && isTokenChar(key.back()) && isTokenChar(c) ) {
+            key += ' ';
+        }
+        key += c;
+        pendingSpace = false;
+    }
+
+    return key;
+}
+
+std::shared_ptr<const Expression> ExpressionCache::get(const std::string &mathExpr) {
+    std::string key = normalize(mathExpr);
+
+    std::shared_ptr<const Expression> cached;
+    size_t measured = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(key);
+        if ( found != index.end() ) {
+            ++counters.hits;
+            entries.splice(entries.begin(), entries, found -> second);
+            cached = found -> second -> expr;
+            measured = found -> second -> builds;
+        }
+        else {
+            ++counters.misses;
+        }
+    }
+    if ( cached ) {
+        if ( cached -> buildCount() != measured ) {
+            remeasure(key, cached);
+        }
+        return cached;
+    }
+
+    // Built outside the lock so other lookups are not held up; if two
+    // threads miss on the same key, the first one inserted is kept
+    DiffOptions buildOptions = options;
+    buildOptions.report = nullptr;
+    auto expr = std::make_shared<const Expression>(key, buildOptions);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if ( found != index.end() ) {
+        entries.splice(entries.begin(), entries, found -> second);
+        return found -> second -> expr;
+    }
+
+    size_t builds = expr -> buildCount();
+    size_t bytes = expr -> memoryBytes();
+    entries.push_front({ key, expr, bytes, builds });
+    index.emplace(key, entries.begin());
+    counters.bytes += bytes;
+    evict();
+
+    return expr;
+}
+
+std::tuple<Func, Func, Func> ExpressionCache::differentiate(const std::string &mathExpr) {
+    std::shared_ptr<const Expression> expr = get(mathExpr);
+
+    Func f = [expr](Complex x) { return expr -> eval(0, x); };
+    Func f1 = [expr](Complex x) { return expr -> eval(1, x); };
+    Func f2 = [expr](Complex x) { return expr -> eval(2, x); };
+
+    return std::make_tuple(f, f1, f2);
+}
+
+// Measured outside the lock, since memoryBytes() waits for builds in progress
+void ExpressionCache::remeasure(const std::string &key, const std::shared_ptr<const Expression> &expr) {
+    size_t builds = expr -> buildCount();
+    size_t bytes = expr -> memoryBytes();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if ( found == index.end() || found -> second -> expr != expr || found -> second -> builds >= builds ) {
+        return;     // Evicted meanwhile, or already measured by another thread
+    }
+
+    Entry &entry = *found -> second;
+    counters.bytes = counters.bytes - entry.bytes + bytes;
+    entry.bytes = bytes;
+    entry.builds = builds;
+    evict();
+}
+
+// Drop least recently used entries until both limits hold; the newest entry always stays
+void ExpressionCache::evict() {
+    while ( entries.size() > 1 && ( entries.size() > capacity || ( maxBytes && counters.bytes > maxBytes ) ) ) {
+        const Entry &last = entries.back();
+        counters.bytes -= last.bytes;
+        index.erase(last.key);
+        entries.pop_back();
+        ++counters.evictions;
+    }
+}
+
+CacheStats ExpressionCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    CacheStats result = counters;
+    result.entries = entries.size();
+
+    return result;
+}
+
+void ExpressionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.clear();
+    index.clear();
+    counters.bytes = 0;
+}
@@ -0,0 +1,265 @@
+// src/catalog.cpp
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catalog.hpp"
+#include "cache.hpp"
+#include "expression.hpp"
+#include "functions.hpp"
+#include "mapped_file.hpp"
+#include "tape.hpp"
+
+
+
+// File layout: Header, EntryRecord[entryCount], then the data each record
+// points to (source text, instructions, constants, result registers), every
+// array aligned for its element type. Offsets are from the start of the file.
+namespace {
+
+const char magic[8] = { 'D', 'I', 'F', 'F', 'C', 'A', 'T', '\0' };
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t complexBytes;         // sizeof(Complex) of the writer
+    std::uint32_t instructionBytes;     // sizeof(Instruction) of the writer
+    std::uint64_t fileBytes;
+};
+
+constexpr size_t dataAlignment = alignof(Complex);
+
+size_t alignUp(size_t offset) {
+    return ( offset + dataAlignment - 1 ) / dataAlignment * dataAlignment;
+}
+
+} // namespace
+
+struct Catalog::TapeRecord {
+    std::uint64_t codeOffset;
+    std::uint64_t constantsOffset;
+    std::uint64_t resultsOffset;
+    std::uint32_t codeSize;
+    std::uint32_t constantCount;
+    std::uint32_t outputCount;
+    std::uint32_t registers;
+    std::uint32_t variables;
+    std::uint32_t reserved;
+};
+
+struct Catalog::EntryRecord {
+    std::uint64_t textOffset;
+    std::uint64_t textBytes;
+    TapeRecord tapes[3];    // f, f', f''
+};
+
+
+
+namespace {
+
+// Appends arrays at aligned offsets and remembers where each one went
+class Writer {
+public:
+    std::vector<char> data;
+
+    explicit Writer(size_t start) : data(start, 0) {}
+
+    std::uint64_t append(const void *src, size_t bytes) {
+        data.resize(alignUp(data.size()), 0);
+        size_t offset = data.size();
+        data.resize(offset + bytes);
+        if ( bytes )  std::memcpy(data.data() + offset, src, bytes);
+        return offset;
+    }
+};
+
+} // namespace
+
+void Catalog::write(const std::string &path, const std::vector<std::string> &expressions, const DiffOptions &options) {
+    const size_t tableBytes = sizeof(Header) + expressions.size() * sizeof(EntryRecord);
+    Writer writer(tableBytes);
+    std::vector<EntryRecord> entries(expressions.size());
+
+    for ( size_t i = 0; i < expressions.size(); ++i ) {
+        std::string text = ExpressionCache::normalize(expressions[i]);
+        Expression expr(text, options);
+
+        EntryRecord &entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.textOffset = writer.append(text.data(), text.size());
+        entry.textBytes = text.size();
+
+        for ( int order = 0; order <= 2; ++order ) {
+            TapeView tape = expr.tape(order).view();
+
+            // Copied field by field into zeroed arrays, so the padding written to
+            // the file (after Instruction::op, after the 80 bits of an x86 long double) is zero
+            std::vector<Instruction> code(tape.codeSize);
+            std::memset(code.data(), 0, code.size() * sizeof(Instruction));
+            for ( size_t k = 0; k < tape.codeSize; ++k ) {
+                code[k].op = tape.code[k].op;
+                code[k].dst = tape.code[k].dst;
+                code[k].a = tape.code[k].a;
+                code[k].b = tape.code[k].b;
+            }
+
+            std::vector<Complex> constants(tape.constantCount);
+            std::memset(static_cast<void *>(constants.data()), 0, constants.size() * sizeof(Complex));
+            for ( size_t k = 0; k < tape.constantCount; ++k ) {
+                reinterpret_cast<long double *>(&constants[k])[0] = tape.constants[k].real();
+                reinterpret_cast<long double *>(&constants[k])[1] = tape.constants[k].imag();
+            }
+
+            TapeRecord &record = entry.tapes[order];
+            record.codeOffset = writer.append(code.data(), code.size() * sizeof(Instruction));
+            record.constantsOffset = writer.append(constants.data(), constants.size() * sizeof(Complex));
+            record.resultsOffset = writer.append(tape.results, tape.outputCount * sizeof(std::uint32_t));
+            record.codeSize = static_cast<std::uint32_t>(tape.codeSize);
+            record.constantCount = static_cast<std::uint32_t>(tape.constantCount);
+            record.outputCount = static_cast<std::uint32_t>(tape.outputCount);
+            record.registers = tape.registers;
+            record.variables = tape.variables;
+        }
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.entryCount = static_cast<std::uint32_t>(expressions.size());
+    header.complexBytes = sizeof(Complex);
+    header.instructionBytes = sizeof(Instruction);
+    header.fileBytes = writer.data.size();
+
+    std::memcpy(writer.data.data(), &header, sizeof(header));
+    if ( !entries.empty() ) {
+        std::memcpy(writer.data.data() + sizeof(header), entries.data(), entries.size() * sizeof(EntryRecord));
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(writer.data.data(), static_cast<std::streamsize>(writer.data.size()));
+    if ( !out ) {
+        throw std::runtime_error(path + ": cannot write catalog");
+    }
+}
+
+
+
+Catalog::Catalog(const std::string &path) : file(MappedFile::openRead(path)) {
+    validate(path);
+
+    count = reinterpret_cast<const Header *>(bytes()) -> entryCount;
+    entries = reinterpret_cast<const EntryRecord *>(bytes() + sizeof(Header));
+
+    index.reserve(count);
+    for ( size_t i = 0; i < count; ++i ) {
+        index.emplace(expression(i), i);
+    }
+}
+
+std::string_view Catalog::expression(size_t entry) const {
+    return std::string_view(bytes() + entries[entry].textOffset, entries[entry].textBytes);
+}
+
+TapeView Catalog::tape(size_t entry, int order) const {
+    if ( entry >= count || order < 0 || order > 2 ) {
+        throw std::runtime_error("No such catalog tape");
+    }
+
+    const TapeRecord &record = entries[entry].tapes[order];
+    return { reinterpret_cast<const Instruction *>(bytes() + record.codeOffset), record.codeSize,
+             reinterpret_cast<const Complex *>(bytes() + record.constantsOffset), record.constantCount,
+             reinterpret_cast<const std::uint32_t *>(bytes() + record.resultsOffset), record.outputCount,
+             record.registers, record.variables };
+}
+
+const size_t *Catalog::find(const std::string &mathExpr) const {
+    std::string key = ExpressionCache::normalize(mathExpr);
+    auto found = index.find(key);
+    return ( found != index.end() ) ? &found -> second : nullptr;
+}
+
+// Everything evaluation will read is checked once here: records inside the
+// file, arrays aligned, and every operand, constant, variable and FuncId in range
+void Catalog::validate(const std::string &path) const {
+    auto fail = [&](const std::string &why) {
+        throw std::runtime_error(path + ": " + why);
+    };
+
+    const size_t size = file.size();
+    auto inFile = [&](std::uint64_t offset, std::uint64_t elements, size_t elementBytes) {
+        return offset <= size && elements <= ( size - offset ) / elementBytes;
+    };
+
+    if ( size < sizeof(Header) ) {
+        fail("too small for a catalog");
+    }
+
+    const Header &header = *reinterpret_cast<const Header *>(bytes());
+    if ( std::memcmp(header.magic, magic, sizeof(magic)) != 0 ) {
+        fail("not a catalog file");
+    }
+    if ( header.version != version ) {
+        fail("catalog version " + std::to_string(header.version) + ", expected " + std::to_string(version));
+    }
+    if ( header.complexBytes != sizeof(Complex) || header.instructionBytes != sizeof(Instruction) ) {
+        fail("catalog written with an incompatible data layout");
+    }
+    if ( header.fileBytes != size || !inFile(sizeof(Header), header.entryCount, sizeof(EntryRecord)) ) {
+        fail("truncated catalog");
+    }
+
+    auto records = reinterpret_cast<const EntryRecord *>(bytes() + sizeof(Header));
+    for ( size_t i = 0; i < header.entryCount; ++i ) {
+        const EntryRecord &entry = records[i];
+        if ( !inFile(entry.textOffset, entry.textBytes, 1) ) {
+            fail("entry " + std::to_string(i) + " outside the file");
+        }
+
+        for ( const TapeRecord &tape : entry.tapes ) {
+            if ( !inFile(tape.codeOffset, tape.codeSize, sizeof(Instruction))
+              || !inFile(tape.constantsOffset, tape.constantCount, sizeof(Complex))
+              || !inFile(tape.resultsOffset, tape.outputCount, sizeof(std::uint32_t))
+              || tape.codeOffset % alignof(Instruction) || tape.constantsOffset % alignof(Complex)
+              || tape.resultsOffset % alignof(std::uint32_t) || tape.outputCount == 0 ) {
+                fail("entry " + std::to_string(i) + " outside the file");
+            }
+
+            auto code = reinterpret_cast<const Instruction *>(bytes() + tape.codeOffset);
+            for ( size_t k = 0; k < tape.codeSize; ++k ) {
+                const Instruction &instr = code[k];
+                bool valid = instr.dst < tape.registers;
+
+                switch (instr.op) {
+                    case OpCode::Const:  valid = valid && instr.a < tape.constantCount; break;
+                    case OpCode::Var:    valid = valid && instr.a < tape.variables; break;
+                    case OpCode::Add:
+                    case OpCode::Sub:
+                    case OpCode::Mul:
+                    case OpCode::Div:
+                    case OpCode::Pow:    valid = valid && instr.a < tape.registers && instr.b < tape.registers; break;
+                    case OpCode::PowInt: valid = valid && instr.a < tape.registers; break;
+                    case OpCode::Call:   valid = valid && instr.a < tape.registers && instr.b < funcCount; break;
+                    case OpCode::Poly:
+                        valid = valid && instr.a < tape.registers
+                                      && size_t(polyOffset(instr.b)) + polyDegree(instr.b) < tape.constantCount;
+                        break;
+                    default:             valid = false;
+                }
+                if ( !valid ) {
+                    fail("invalid instruction in entry " + std::to_string(i));
+                }
+            }
+
+            auto results = reinterpret_cast<const std::uint32_t *>(bytes() + tape.resultsOffset);
+            for ( size_t k = 0; k < tape.outputCount; ++k ) {
+                if ( results[k] >= tape.registers )  fail("invalid output in entry " + std::to_string(i));
+            }
+        }
+    }
+}
@@ -1,30 +1,120 @@
 // src/differentiator.cpp
 
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include "differentiator.hpp"
-#include "parser.hpp"
-#include "ast.hpp"
+#include "expression.hpp"
+#include "jit.hpp"
 
 
 
 // Returns (f, f', f'') as tuple
-std::tuple<Func, Func, Func> differentiate(const std::string &mathExpr) {
-    Parser parser(mathExpr);
-
-    NodePtr originalTree = parser.parse();
-    NodePtr firstDerivativeTree = originalTree -> deriv();
-    NodePtr secondDerivativeTree = firstDerivativeTree -> deriv();
+std::tuple<Func, Func, Func> differentiate(const std::string &mathExpr, const DiffOptions &options) {
+    // Shared by the three callables, which keep it alive
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
     
-    Func f = [originalTree](Complex x) {
-        return originalTree -> eval(x);
+    Func f = [expr](Complex x) {
+        return expr -> eval(0, x);
     };
     
-    Func f1 = [firstDerivativeTree](Complex x) {
-        return firstDerivativeTree -> eval(x);
+    Func f1 = [expr](Complex x) {
+        return expr -> eval(1, x);
     };
     
-    Func f2 = [secondDerivativeTree](Complex x) {
-        return secondDerivativeTree -> eval(x);
+    Func f2 = [expr](Complex x) {
+        return expr -> eval(2, x);
     };
     
     return std::make_tuple(f, f1, f2);
 }
+
+std::tuple<ExpressionFunc, ExpressionFunc, ExpressionFunc> differentiateDirect(const std::string &mathExpr, const DiffOptions &options) {
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
+
+    return std::make_tuple(ExpressionFunc{ expr, 0 }, ExpressionFunc{ expr, 1 }, ExpressionFunc{ expr, 2 });
+}
+
+std::vector<Func> differentiateUpTo(const std::string &mathExpr, int maxOrder, const DiffOptions &options) {
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
+
+    std::vector<Func> funcs;
+    for ( int order = 0; order <= maxOrder; ++order ) {
+        funcs.push_back([expr, order](Complex x) {
+            return expr -> eval(order, x);
+        });
+    }
+
+    return funcs;
+}
+
+// Returns a callable yielding {f, f', ..., f^(n)}
+SeriesFunc differentiateN(const std::string &mathExpr, int n, const DiffOptions &options) {
+    if ( n < 0 ) {
+        throw std::runtime_error("Derivative order out of range: " + std::to_string(n));
+    }
+
+    // Only f is ever built; derivatives come from Taylor propagation
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
+
+    return [expr, n](Complex x) {
+        std::vector<Complex> derivs(n + 1);
+        expr -> evalDerivatives(x, n, derivs.data());
+        return derivs;
+    };
+}
+
+// Returns a callable yielding {f, f', f''}
+FusedFunc differentiateFused(const std::string &mathExpr, const DiffOptions &options) {
+    DiffOptions fusedOptions = options;
+    fusedOptions.shareSubexpressions = true;
+
+    auto expr = std::make_shared<const Expression>(mathExpr, fusedOptions);
+
+    return [expr](Complex x) {
+        return expr -> evalAll(x);
+    };
+}
+
+// Native code when the JIT can build it, the trees otherwise
+NativeFuncs differentiateNative(const std::string &mathExpr, const DiffOptions &options) {
+    auto expr = std::make_shared<const Expression>(mathExpr, options);
+
+    std::shared_ptr<const JitModule> module;
+    if ( JitModule::available() && options.engine == Engine::Symbolic ) {
+        try {
+            module = JitModule::compile({ expr -> tree(0), expr -> tree(1), expr -> tree(2) });
+        }
+        catch (const std::runtime_error &) {
+            module = nullptr;
+        }
+    }
+
+    NativeFuncs funcs;
+    Func *scalar[3] = { &funcs.f, &funcs.f1, &funcs.f2 };
+    BatchFunc *batch[3] = { &funcs.batch, &funcs.batch1, &funcs.batch2 };
+
+    for ( int order = 0; order < 3; ++order ) {
+        if ( module ) {
+            *scalar[order] = [module, order](Complex x) {
+                return module -> eval(order, x);
+            };
+            *batch[order] = [module, order](const Complex *in, Complex *out, size_t n) {
+                module -> evalBatch(order, in, out, n);
+            };
+        }
+        else {
+            *scalar[order] = [expr, order](Complex x) {
+                return expr -> eval(order, x);
+            };
+            *batch[order] = [expr, order](const Complex *in, Complex *out, size_t n) {
+                expr -> evalBatch(order, in, out, n);
+            };
+        }
+    }
+    funcs.native = ( module != nullptr );
+
+    return funcs;
+}
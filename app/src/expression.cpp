@@ -0,0 +1,323 @@
+// src/expression.cpp
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "expression.hpp"
+#include "parser.hpp"
+#include "arena.hpp"
+#include "intern.hpp"
+#include "simplify.hpp"
+#include "poly.hpp"
+#include "tape.hpp"
+
+
+
+namespace {
+
+// Simplify a freshly built tree if enabled, recording its node counts
+NodePtr prepare(const NodePtr &tree, int order, const DiffOptions &options) {
+    NodePtr result = options.simplify ? simplify(tree) : tree;
+    if ( options.polynomials ) {
+        result = collectPolynomials(result);
+    }
+
+    if ( options.report && order < 3 ) {
+        options.report -> nodesBefore[order] = countNodes(tree);
+        options.report -> nodesAfter[order] = countNodes(result);
+    }
+
+    return result;
+}
+
+void checkOrder(int order) {
+    if ( order < 0 ) {
+        throw std::runtime_error("Derivative order out of range: " + std::to_string(order));
+    }
+}
+
+} // namespace
+
+
+
+Expression::Expression(const std::string &mathExpr, const DiffOptions &opts) : options(opts) {
+    if ( options.useArena ) {
+        arena = std::make_shared<NodeArena>();
+    }
+    if ( options.shareSubexpressions ) {
+        // One factory for all orders, so f'' reuses the nodes of f and f'
+        factory = std::make_unique<NodeFactory>();
+    }
+
+    // f is built right away, so syntax errors surface here
+    std::call_once(low[0].built, [&] { build(0, low[0], &mathExpr); });
+
+    if ( options.report ) {
+        int orders = ( options.engine == Engine::Jet ) ? 1 : 3;
+        for ( int order = 1; order < orders; ++order ) {
+            get(order);
+        }
+    }
+
+    options.report = nullptr;   // Only valid during construction
+}
+
+const Expression::Order &Expression::get(int order) const {
+    checkOrder(order);
+
+    Order *slot;
+    if ( order < 3 ) {
+        slot = &low[order];
+    }
+    else {
+        // deque::emplace_back leaves existing slots in place
+        std::lock_guard<std::mutex> lock(highMutex);
+        while ( high.size() <= static_cast<size_t>(order - 3) ) {
+            high.emplace_back();
+        }
+        slot = &high[order - 3];
+    }
+
+    std::call_once(slot -> built, [&] {
+        get(order - 1);     // Lower orders first, outside the build lock
+        build(order, *slot, nullptr);
+    });
+
+    return *slot;
+}
+
+// Order 0 is parsed from source; order n is taken from the already simplified order n - 1
+void Expression::build(int order, Order &slot, const std::string *source) const {
+    std::lock_guard<std::mutex> lock(buildMutex);
+
+    // Every node built below, including intermediates, lands in the arena
+    std::unique_ptr<ArenaScope> scope;
+    if ( arena ) {
+        scope = std::make_unique<ArenaScope>(*arena);
+    }
+
+    NodePtr tree = source ? Parser(*source).parse() : get(order - 1).tree -> deriv();
+    tree = prepare(tree, order, options);
+    if ( factory ) {
+        tree = factory -> intern(tree);
+    }
+
+    slot.tape = Tape::compile(tree);
+    slot.tree = tree;
+    ++builds;
+}
+
+const Tape &Expression::fusedTape() const {
+    std::call_once(fusedBuilt, [&] {
+        std::vector<NodePtr> trees = { get(0).tree, get(1).tree, get(2).tree };
+
+        std::lock_guard<std::mutex> lock(buildMutex);
+        fused = Tape::compile(trees);
+        ++builds;
+    });
+
+    return fused;
+}
+
+Complex Expression::eval(int order, const Complex &x) const {
+    checkOrder(order);
+
+    if ( usesJet(order) ) {
+        Jet jet = low[0].tape.evalJet(x);
+        return ( order == 1 ) ? jet.f1 : jet.f2;
+    }
+
+    const Order &slot = get(order);
+    if ( options.useTape || options.shareSubexpressions ) {
+        return slot.tape.eval(x);
+    }
+    return slot.tree -> eval(x);
+}
+
+Jet Expression::evalJet(const Complex &x) const {
+    return low[0].tape.evalJet(x);
+}
+
+BoxJet Expression::bound(const Box &x) const {
+    return low[0].tape.evalBox(x);
+}
+
+Jet Expression::evalAll(const Complex &x) const {
+    if ( options.engine == Engine::Jet ) {
+        return low[0].tape.evalJet(x);
+    }
+
+    Complex values[3];
+    fusedTape().evalOutputs(x, values);
+
+    return { values[0], values[1], values[2] };
+}
+
+void Expression::evalTaylor(const Complex &x, int maxOrder, Complex *coeffs) const {
+    checkOrder(maxOrder);
+    low[0].tape.evalTaylor(x, static_cast<size_t>(maxOrder), coeffs);
+}
+
+void Expression::evalDerivatives(const Complex &x, int maxOrder, Complex *derivs) const {
+    evalTaylor(x, maxOrder, derivs);
+
+    // f^(k) = k! c_k
+    long double factorial = 1.0;
+    for ( int k = 1; k <= maxOrder; ++k ) {
+        factorial *= k;
+        derivs[k] *= factorial;
+    }
+}
+
+void Expression::evalBatch(int order, const Complex *in, Complex *out, size_t n) const {
+    checkOrder(order);
+
+    if ( usesJet(order) ) {
+        for ( size_t i = 0; i < n; ++i ) {
+            out[i] = eval(order, in[i]);
+        }
+        return;
+    }
+    get(order).tape.evalBatch(in, out, n);
+}
+
+template <typename T>
+std::complex<T> Expression::evalAs(int order, const std::complex<T> &x) const {
+    if constexpr ( std::is_same_v<T, long double> ) {
+        return eval(order, x);
+    }
+    else {
+        checkOrder(order);
+
+        if ( usesJet(order) ) {
+            return std::complex<T>(eval(order, Complex(x)));
+        }
+        return get(order).tape.evalAs<T>(x);
+    }
+}
+
+template std::complex<float> Expression::evalAs<float>(int, const std::complex<float> &) const;
+template std::complex<double> Expression::evalAs<double>(int, const std::complex<double> &) const;
+template std::complex<long double> Expression::evalAs<long double>(int, const std::complex<long double> &) const;
+
+template <typename T>
+void Expression::evalBatchAs(int order, const std::complex<T> *in, std::complex<T> *out, size_t n) const {
+    if constexpr ( std::is_same_v<T, long double> ) {
+        evalBatch(order, in, out, n);
+    }
+    else {
+        checkOrder(order);
+
+        if ( usesJet(order) ) {
+            for ( size_t i = 0; i < n; ++i ) {
+                out[i] = evalAs<T>(order, in[i]);
+            }
+            return;
+        }
+        get(order).tape.evalBatchAs<T>(in, out, n);
+    }
+}
+
+template void Expression::evalBatchAs<float>(int, const std::complex<float> *, std::complex<float> *, size_t) const;
+template void Expression::evalBatchAs<double>(int, const std::complex<double> *, std::complex<double> *, size_t) const;
+template void Expression::evalBatchAs<long double>(int, const std::complex<long double> *, std::complex<long double> *, size_t) const;
+
+void Expression::evalBatchSoA(int order, const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n) const {
+    checkOrder(order);
+
+    if ( usesJet(order) ) {
+        for ( size_t i = 0; i < n; ++i ) {
+            Complex value = eval(order, Complex(inRe[i], inIm[i]));
+            outRe[i] = static_cast<double>(value.real());
+            outIm[i] = static_cast<double>(value.imag());
+        }
+        return;
+    }
+    get(order).tape.evalBatchSoA(inRe, inIm, outRe, outIm, n);
+}
+
+void Expression::evalParallel(int order, const Complex *in, Complex *out, size_t n, ThreadPool &pool) const {
+    pool.parallelFor(n, parallelChunk, [&](size_t begin, size_t end) {
+        evalBatch(order, in + begin, out + begin, end - begin);
+    });
+}
+
+void Expression::evalParallelSoA(int order, const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n, ThreadPool &pool) const {
+    pool.parallelFor(n, parallelChunk, [&](size_t begin, size_t end) {
+        evalBatchSoA(order, inRe + begin, inIm + begin, outRe + begin, outIm + begin, end - begin);
+    });
+}
+
+NodePtr Expression::tree(int order) const {
+    const Order &slot = get(order);
+
+    if ( arena ) {
+        return NodePtr(arena, slot.tree.get());
+    }
+    return slot.tree;
+}
+
+const Tape &Expression::tape(int order) const {
+    return get(order).tape;
+}
+
+size_t Expression::memoryBytes() const {
+    // Holding the build lock keeps the set of built orders and the arena still
+    std::lock_guard<std::mutex> buildLock(buildMutex);
+    std::lock_guard<std::mutex> highLock(highMutex);
+
+    std::vector<const Order *> slots = { &low[0], &low[1], &low[2] };
+    for ( const Order &slot : high ) {
+        slots.push_back(&slot);
+    }
+
+    size_t bytes = sizeof(Expression) + fused.memoryBytes();
+    for ( const Order *slot : slots ) {
+        bytes += slot -> tape.memoryBytes();
+
+        // Heap nodes: object plus shared_ptr control block, roughly
+        if ( !arena && slot -> tree ) {
+            bytes += countNodes(slot -> tree) * (sizeof(BinaryNode) + 16);
+        }
+    }
+    if ( arena ) {
+        bytes += arena -> bytesReserved() + arena -> nodeCount() * sizeof(Node *);
+    }
+
+    return bytes;
+}
+
+
+long double engineDeviation(const std::string &mathExpr, const std::vector<Complex> &points) {
+    DiffOptions jetOptions;
+    jetOptions.engine = Engine::Jet;
+
+    Expression symbolic(mathExpr);
+    Expression jet(mathExpr, jetOptions);
+    long double worst = 0.0;
+
+    for ( const Complex &x : points ) {
+        Jet j = jet.evalJet(x);
+        const Complex got[2] = { j.f1, j.f2 };
+
+        for ( int order = 1; order <= 2; ++order ) {
+            Complex want = symbolic.eval(order, x);
+            Complex value = got[order - 1];
+
+            if ( std::isnan(std::abs(want)) && std::isnan(std::abs(value)) ) {
+                continue;
+            }
+            if ( want == value ) {
+                continue;
+            }
+
+            long double scale = std::max(std::abs(want), std::abs(value));
+            long double deviation = std::abs(want - value) / scale;
+            worst = std::max(worst, std::isnan(deviation) ? INFINITY : deviation);
+        }
+    }
+
+    return worst;
+}
@@ -0,0 +1,381 @@
+// src/functions.cpp
+#include <complex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "functions.hpp"
+#include "ast.hpp"
+#include "arena.hpp"
+#include "series.hpp"
+
+
+
+namespace {
+
+NodePtr constant(long double value) {
+    return makeNode<ConstNode>(value);
+}
+
+NodePtr call(FuncId id, const NodePtr &u) {
+    return makeNode<FuncNode>(id, u);
+}
+
+// The helpers below take their operand by value, so a freshly built
+// subtree is moved into its parent instead of copied
+NodePtr square(NodePtr u) {
+    return makePower(std::move(u), constant(2.0));
+}
+
+NodePtr negate(NodePtr u) {
+    return makeNode<BinaryNode>('*', constant(-1.0), std::move(u));
+}
+
+NodePtr reciprocal(NodePtr u) {
+    return makeNode<BinaryNode>('/', constant(1.0), std::move(u));
+}
+
+
+// Outer derivatives g'(u)
+
+// d/dz sin(z) = cos(z)
+NodePtr sinDeriv(const NodePtr &u) { return call(FuncId::Cos, u); }
+
+// d/dz cos(z) = -sin(z)
+NodePtr cosDeriv(const NodePtr &u) { return negate(call(FuncId::Sin, u)); }
+
+// d/dz tan(z) = 1 / cos(z)^2
+NodePtr tanDeriv(const NodePtr &u) { return reciprocal(square(call(FuncId::Cos, u))); }
+
+// d/dz cot(z) = -1 / sin(z)^2
+NodePtr cotDeriv(const NodePtr &u) { return negate(reciprocal(square(call(FuncId::Sin, u)))); }
+
+// d/dz log(z) = 1 / z
+NodePtr logDeriv(const NodePtr &u) { return reciprocal(u); }
+
+// d/dz exp(z) = exp(z)
+NodePtr expDeriv(const NodePtr &u) { return call(FuncId::Exp, u); }
+
+// d/dz sqrt(z) = 1 / (2 sqrt(z))
+NodePtr sqrtDeriv(const NodePtr &u) {
+    return reciprocal(makeNode<BinaryNode>('*', constant(2.0), call(FuncId::Sqrt, u)));
+}
+
+// d/dz sinh(z) = cosh(z)
+NodePtr sinhDeriv(const NodePtr &u) { return call(FuncId::Cosh, u); }
+
+// d/dz cosh(z) = sinh(z)
+NodePtr coshDeriv(const NodePtr &u) { return call(FuncId::Sinh, u); }
+
+// d/dz tanh(z) = 1 / cosh(z)^2
+NodePtr tanhDeriv(const NodePtr &u) { return reciprocal(square(call(FuncId::Cosh, u))); }
+
+// d/dz asin(z) = 1 / sqrt(1 - z^2)
+NodePtr asinDeriv(const NodePtr &u) {
+    return reciprocal(call(FuncId::Sqrt, makeNode<BinaryNode>('-', constant(1.0), square(u))));
+}
+
+// d/dz acos(z) = -1 / sqrt(1 - z^2)
+NodePtr acosDeriv(const NodePtr &u) { return negate(asinDeriv(u)); }
+
+// d/dz atan(z) = 1 / (1 + z^2)
+NodePtr atanDeriv(const NodePtr &u) {
+    return reciprocal(makeNode<BinaryNode>('+', constant(1.0), square(u)));
+}
+
+
+// Jets: g, g', g'' at z
+
+void sinJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::sin(z);
+    d1 = std::cos(z);
+    d2 = -g;
+}
+
+void cosJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::cos(z);
+    d1 = -std::sin(z);
+    d2 = -g;
+}
+
+// tan' = 1 + tan^2,  tan'' = 2 tan (1 + tan^2)
+void tanJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::tan(z);
+    d1 = Complex(1.0) + g * g;
+    d2 = Complex(2.0) * g * d1;
+}
+
+// cot' = -(1 + cot^2),  cot'' = 2 cot (1 + cot^2)
+void cotJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = Complex(1.0) / std::tan(z);
+    Complex s = Complex(1.0) + g * g;
+    d1 = -s;
+    d2 = Complex(2.0) * g * s;
+}
+
+void logJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::log(z);
+    d1 = Complex(1.0) / z;
+    d2 = -d1 * d1;
+}
+
+void expJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::exp(z);
+    d1 = g;
+    d2 = g;
+}
+
+// sqrt' = 1 / (2 sqrt z),  sqrt'' = -sqrt' / (2z)
+void sqrtJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::sqrt(z);
+    d1 = Complex(1.0) / (Complex(2.0) * g);
+    d2 = -d1 / (Complex(2.0) * z);
+}
+
+void sinhJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::sinh(z);
+    d1 = std::cosh(z);
+    d2 = g;
+}
+
+void coshJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::cosh(z);
+    d1 = std::sinh(z);
+    d2 = g;
+}
+
+// tanh' = 1 - tanh^2,  tanh'' = -2 tanh (1 - tanh^2)
+void tanhJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::tanh(z);
+    d1 = Complex(1.0) - g * g;
+    d2 = Complex(-2.0) * g * d1;
+}
+
+// asin' = (1 - z^2)^(-1/2),  asin'' = z (1 - z^2)^(-3/2)
+void asinJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    Complex q = Complex(1.0) - z * z;
+    g = std::asin(z);
+    d1 = Complex(1.0) / std::sqrt(q);
+    d2 = z * d1 / q;
+}
+
+void acosJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    asinJet(z, g, d1, d2);
+    g = std::acos(z);
+    d1 = -d1;
+    d2 = -d2;
+}
+
+// atan' = 1 / (1 + z^2),  atan'' = -2z / (1 + z^2)^2
+void atanJet(const Complex &z, Complex &g, Complex &d1, Complex &d2) {
+    g = std::atan(z);
+    d1 = Complex(1.0) / (Complex(1.0) + z * z);
+    d2 = Complex(-2.0) * z * d1 * d1;
+}
+
+
+
+// Taylor coefficients of g(u)
+
+void sinTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> c(n);
+    series::sinCos(u, g, c.data(), n);
+}
+
+void cosTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> s(n);
+    series::sinCos(u, s.data(), g, n);
+}
+
+void tanTaylor(const Complex *u, Complex *g, size_t n) {
+    g[0] = std::tan(u[0]);
+    series::riccati(u, g, 1.0, 1.0, n);
+}
+
+void cotTaylor(const Complex *u, Complex *g, size_t n) {
+    g[0] = Complex(1.0) / std::tan(u[0]);
+    series::riccati(u, g, -1.0, -1.0, n);
+}
+
+void logTaylor(const Complex *u, Complex *g, size_t n) { series::log(u, g, n); }
+void expTaylor(const Complex *u, Complex *g, size_t n) { series::exp(u, g, n); }
+void sqrtTaylor(const Complex *u, Complex *g, size_t n) { series::sqrt(u, g, n); }
+
+void sinhTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> c(n);
+    series::sinhCosh(u, g, c.data(), n);
+}
+
+void coshTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> s(n);
+    series::sinhCosh(u, s.data(), g, n);
+}
+
+void tanhTaylor(const Complex *u, Complex *g, size_t n) {
+    g[0] = std::tanh(u[0]);
+    series::riccati(u, g, 1.0, -1.0, n);
+}
+
+// h = 1 / sqrt(1 - u^2), the outer derivative of asin
+std::vector<Complex> asinOuter(const Complex *u, size_t n) {
+    std::vector<Complex> q(n), r(n), one(n), h(n);
+    series::mul(u, u, q.data(), n);
+    for ( Complex &c : q ) {
+        c = -c;
+    }
+    q[0] += Complex(1.0);
+    series::sqrt(q.data(), r.data(), n);
+    one[0] = Complex(1.0);
+    series::div(one.data(), r.data(), h.data(), n);
+
+    return h;
+}
+
+void asinTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> h = asinOuter(u, n);
+    g[0] = std::asin(u[0]);
+    series::integrate(u, h.data(), g, n);
+}
+
+void acosTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> h = asinOuter(u, n);
+    for ( Complex &c : h ) {
+        c = -c;
+    }
+    g[0] = std::acos(u[0]);
+    series::integrate(u, h.data(), g, n);
+}
+
+// h = 1 / (1 + u^2), the outer derivative of atan
+void atanTaylor(const Complex *u, Complex *g, size_t n) {
+    std::vector<Complex> q(n), one(n), h(n);
+    series::mul(u, u, q.data(), n);
+    q[0] += Complex(1.0);
+    one[0] = Complex(1.0);
+    series::div(one.data(), q.data(), h.data(), n);
+
+    g[0] = std::atan(u[0]);
+    series::integrate(u, h.data(), g, n);
+}
+
+
+
+// Box jets: the jet identities above in interval arithmetic
+
+void sinBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::sin(z);
+    d1 = interval::cos(z);
+    d2 = -g;
+}
+
+void cosBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::cos(z);
+    d1 = -interval::sin(z);
+    d2 = -g;
+}
+
+void tanBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::tan(z);
+    d1 = Box(Complex(1.0)) + interval::sqr(g);
+    d2 = Box(Complex(2.0)) * g * d1;
+}
+
+void cotBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::cot(z);
+    Box s = Box(Complex(1.0)) + interval::sqr(g);
+    d1 = -s;
+    d2 = Box(Complex(2.0)) * g * s;
+}
+
+void logBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::log(z);
+    d1 = Box(Complex(1.0)) / z;
+    d2 = -interval::sqr(d1);
+}
+
+void expBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::exp(z);
+    d1 = g;
+    d2 = g;
+}
+
+void sqrtBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::sqrt(z);
+    d1 = Box(Complex(1.0)) / (Box(Complex(2.0)) * g);
+    d2 = -d1 / (Box(Complex(2.0)) * z);
+}
+
+void sinhBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::sinh(z);
+    d1 = interval::cosh(z);
+    d2 = g;
+}
+
+void coshBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::cosh(z);
+    d1 = interval::sinh(z);
+    d2 = g;
+}
+
+void tanhBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::tanh(z);
+    d1 = Box(Complex(1.0)) - interval::sqr(g);
+    d2 = Box(Complex(-2.0)) * g * d1;
+}
+
+void asinBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    Box q = Box(Complex(1.0)) - interval::sqr(z);
+    g = interval::asin(z);
+    d1 = Box(Complex(1.0)) / interval::sqrt(q);
+    d2 = z * d1 / q;
+}
+
+void acosBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    asinBox(z, g, d1, d2);
+    g = interval::acos(z);
+    d1 = -d1;
+    d2 = -d2;
+}
+
+void atanBox(const Box &z, Box &g, Box &d1, Box &d2) {
+    g = interval::atan(z);
+    d1 = Box(Complex(1.0)) / (Box(Complex(1.0)) + interval::sqr(z));
+    d2 = Box(Complex(-2.0)) * z * interval::sqr(d1);
+}
+
+
+// Indexed by FuncId
+const FuncInfo registry[] = {
+    { FuncId::Sin,  "sin",  sinDeriv,  sinJet,   sinTaylor,  sinBox },
+    { FuncId::Cos,  "cos",  cosDeriv,  cosJet,   cosTaylor,  cosBox },
+    { FuncId::Tan,  "tan",  tanDeriv,  tanJet,   tanTaylor,  tanBox },
+    { FuncId::Cot,  "cot",  cotDeriv,  cotJet,   cotTaylor,  cotBox },
+    { FuncId::Log,  "log",  logDeriv,  logJet,   logTaylor,  logBox },
+    { FuncId::Exp,  "exp",  expDeriv,  expJet,   expTaylor,  expBox },
+    { FuncId::Sqrt, "sqrt", sqrtDeriv, sqrtJet,  sqrtTaylor, sqrtBox },
+    { FuncId::Sinh, "sinh", sinhDeriv, sinhJet,  sinhTaylor, sinhBox },
+    { FuncId::Cosh, "cosh", coshDeriv, coshJet,  coshTaylor, coshBox },
+    { FuncId::Tanh, "tanh", tanhDeriv, tanhJet,  tanhTaylor, tanhBox },
+    { FuncId::Asin, "asin", asinDeriv, asinJet,  asinTaylor, asinBox },
+    { FuncId::Acos, "acos", acosDeriv, acosJet,  acosTaylor, acosBox },
+    { FuncId::Atan, "atan", atanDeriv, atanJet,  atanTaylor, atanBox },
+};
+
+} // namespace
+
+
+
+const FuncInfo &funcInfo(FuncId id) {
+    return registry[static_cast<size_t>(id)];
+}
+
+const FuncInfo *findFunc(std::string_view name) {
+    for ( const FuncInfo &info : registry ) {
+        if ( name == info.name ) {
+            return &info;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,275 @@
+// src/gradient.cpp
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gradient.hpp"
+#include "ast.hpp"
+#include "arena.hpp"
+#include "functions.hpp"
+#include "intern.hpp"
+#include "parser.hpp"
+
+
+
+namespace {
+
+bool isOne(const NodePtr &node) {
+    auto constant = dynamic_cast<const ConstNode *>(node.get());
+    return constant && constant -> value == 1.0L;
+}
+
+// a * b, without the factors 1 the chain rule keeps producing
+NodePtr times(const NodePtr &a, const NodePtr &b) {
+    if ( isOne(a) )  return b;
+    if ( isOne(b) )  return a;
+    return makeNode<BinaryNode>('*', a, b);
+}
+
+// Adds (op '+') or subtracts (op '-') one user's contribution to an adjoint
+void accumulate(NodePtr &adjoint, const NodePtr &term, char op) {
+    if ( adjoint ) {
+        adjoint = makeNode<BinaryNode>(op, adjoint, term);
+    }
+    else {
+        adjoint = ( op == '+' ) ? term : makeNode<BinaryNode>('-', makeNode<ConstNode>(0.0), term);
+    }
+}
+
+// d(u^n)/du = n * u^(n-1), with u^1 = u written out; nullptr for n = 0
+NodePtr intPowerPartial(const IntPowerNode &power) {
+    if ( power.n == 0 ) {
+        return nullptr;
+    }
+
+    NodePtr factor = makeNode<ConstNode>(static_cast<long double>(power.n));
+    if ( power.n == 1 ) {
+        return factor;
+    }
+
+    NodePtr lower = ( power.n == 2 ) ? power.base : makeNode<IntPowerNode>(power.base, power.n - 1);
+    return makeNode<BinaryNode>('*', factor, lower);
+}
+
+// d(u^v)/du: v * u^(v-1) for a constant v (the power rule, as in
+// PowerNode::derivFrom), u^v * (v / u) otherwise
+NodePtr powerBasePartial(const NodePtr &node, const PowerNode &power) {
+    const NodePtr &u = power.base;
+    const NodePtr &v = power.exp;
+
+    if ( v -> constant ) {
+        NodePtr exponent = foldConstant(makeNode<BinaryNode>('-', v, makeNode<ConstNode>(1.0)));
+        return makeNode<BinaryNode>('*', v, makePower(u, exponent));
+    }
+    return makeNode<BinaryNode>('*', node, makeNode<BinaryNode>('/', v, u));
+}
+
+} // namespace
+
+
+
+// Reverse mode on the tree: the adjoint of a node is df/dnode, the sum of
+// adjoint(user) * d(user)/d(node) over its users. Users follow their
+// operands in post order, so walking it backwards completes each adjoint
+// before it is handed on. Constant subtrees get no adjoint at all.
+std::vector<NodePtr> gradient(const NodePtr &f, size_t variables) {
+    std::vector<NodePtr> order;
+    std::unordered_set<const Node *> seen;
+
+    postOrder(f,
+        [&](const Node *node) { return node -> constant || seen.count(node) != 0; },
+        [&](const NodePtr &node) { seen.insert(node.get()); order.push_back(node); });
+
+    std::vector<NodePtr> grad(variables);
+    std::unordered_map<const Node *, NodePtr> adjoints;
+    if ( !order.empty() ) {
+        adjoints.emplace(f.get(), makeNode<ConstNode>(1.0));
+    }
+
+    for ( auto it = order.rbegin(); it != order.rend(); ++it ) {
+        const NodePtr &node = *it;
+
+        // No adjoint: every user has a zero partial by this node (e.g. u^0)
+        auto found = adjoints.find(node.get());
+        if ( found == adjoints.end() ) {
+            continue;
+        }
+        NodePtr adjoint = std::move(found -> second);
+        adjoints.erase(found);
+
+        // adjoint(operand) += adjoint * partial; the partial is only built for operands that have an adjoint
+        auto propagate = [&](const NodePtr &operand, auto &&partial, char op = '+') {
+            if ( !operand -> constant ) {
+                accumulate(adjoints[operand.get()], partial(), op);
+            }
+        };
+
+        switch (node -> kind) {
+            case Node::Kind::Const:
+                break;
+            case Node::Kind::Var: {
+                std::uint32_t index = static_cast<const VarNode &>(*node).index;
+                if ( index >= variables ) {
+                    throw std::runtime_error("Variable index out of range of the gradient");
+                }
+                accumulate(grad[index], adjoint, '+');
+                break;
+            }
+            case Node::Kind::Binary: {
+                auto &binary = static_cast<const BinaryNode &>(*node);
+                const NodePtr &l = binary.left;
+                const NodePtr &r = binary.right;
+
+                switch (binary.op) {
+                    case '+':
+                        propagate(l, [&] { return adjoint; });
+                        propagate(r, [&] { return adjoint; });
+                        break;
+                    case '-':
+                        propagate(l, [&] { return adjoint; });
+                        propagate(r, [&] { return adjoint; }, '-');
+                        break;
+                    case '*':
+                        propagate(l, [&] { return times(adjoint, r); });
+                        propagate(r, [&] { return times(adjoint, l); });
+                        break;
+                    case '/':
+                        // d(l/r)/dl = 1/r, d(l/r)/dr = -(l/r)/r
+                        propagate(l, [&] { return makeNode<BinaryNode>('/', adjoint, r); });
+                        propagate(r, [&] { return makeNode<BinaryNode>('/', times(adjoint, node), r); }, '-');
+                        break;
+                    default:
+                        throw std::runtime_error("Unknown binary op");
+                }
+                break;
+            }
+            case Node::Kind::Power: {
+                auto &power = static_cast<const PowerNode &>(*node);
+
+                // d(u^v)/dv = u^v * ln(u)
+                propagate(power.base, [&] { return times(adjoint, powerBasePartial(node, power)); });
+                propagate(power.exp, [&] {
+                    return times(adjoint, makeNode<BinaryNode>('*', node, makeNode<FuncNode>(FuncId::Log, power.base)));
+                });
+                break;
+            }
+            case Node::Kind::IntPower: {
+                auto &power = static_cast<const IntPowerNode &>(*node);
+                if ( NodePtr partial = intPowerPartial(power) ) {
+                    propagate(power.base, [&] { return times(adjoint, partial); });
+                }
+                break;
+            }
+            case Node::Kind::Func: {
+                auto &func = static_cast<const FuncNode &>(*node);
+                propagate(func.arg, [&] { return times(adjoint, funcInfo(func.func).deriv(func.arg)); });
+                break;
+            }
+            case Node::Kind::Poly: {
+                // dp(u)/du = p'(u), from the coefficients
+                auto &poly = static_cast<const PolyNode &>(*node);
+                propagate(poly.arg, [&] { return times(adjoint, poly.derivFrom(makeNode<ConstNode>(1.0))); });
+                break;
+            }
+        }
+    }
+
+    for ( NodePtr &partial : grad ) {
+        if ( !partial )  partial = makeNode<ConstNode>(0.0);
+    }
+    return grad;
+}
+
+
+
+MultiExpression::MultiExpression(std::string_view mathExpr) {
+    f = Parser(mathExpr, table).parse();
+    build();
+}
+
+MultiExpression::MultiExpression(std::string_view mathExpr, SymbolTable &symbols) {
+    f = Parser(mathExpr, symbols).parse();
+    table = symbols;
+    build();
+}
+
+// f and its gradient through one factory, so the gradient tape computes
+// what the partials share with f and with each other once
+void MultiExpression::build() {
+    partials = ::gradient(f, table.size());
+
+    NodeFactory factory;
+    std::vector<NodePtr> outputs{ factory.intern(f) };
+    for ( const NodePtr &partial : partials ) {
+        outputs.push_back(factory.intern(partial));
+    }
+
+    valueTape = Tape::compile(outputs[0]);
+    gradTape = Tape::compile(outputs);
+}
+
+// Row i of the Hessian is the gradient of df/dvar_i, one sweep per row over
+// the interned gradient; only the upper triangle j >= i becomes an output
+const Tape &MultiExpression::hessianTape() const {
+    std::call_once(hessBuilt, [this] {
+        const size_t n = table.size();
+
+        NodeFactory factory;
+        std::vector<NodePtr> outputs{ factory.intern(f) };
+        for ( const NodePtr &partial : partials ) {
+            outputs.push_back(factory.intern(partial));
+        }
+
+        for ( size_t i = 0; i < n; ++i ) {
+            std::vector<NodePtr> row = ::gradient(outputs[1 + i], n);
+            for ( size_t j = i; j < n; ++j ) {
+                outputs.push_back(factory.intern(row[j]));
+            }
+        }
+
+        hessTape = Tape::compile(outputs);
+    });
+
+    return hessTape;
+}
+
+Complex MultiExpression::eval(const Complex *vars) const {
+    Complex value;
+    valueTape.evalOutputs(vars, &value);
+    return value;
+}
+
+Complex MultiExpression::gradient(const Complex *vars, Complex *grad) const {
+    thread_local std::vector<Complex> out;
+    out.resize(gradTape.outputCount());
+
+    gradTape.evalOutputs(vars, out.data());
+    std::copy(out.begin() + 1, out.end(), grad);
+
+    return out[0];
+}
+
+Complex MultiExpression::hessian(const Complex *vars, Complex *grad, Complex *hess) const {
+    const Tape &tape = hessianTape();
+    const size_t n = table.size();
+
+    thread_local std::vector<Complex> out;
+    out.resize(tape.outputCount());
+
+    tape.evalOutputs(vars, out.data());
+    std::copy(out.begin() + 1, out.begin() + 1 + n, grad);
+
+    const Complex *upper = out.data() + 1 + n;
+    for ( size_t i = 0; i < n; ++i ) {
+        for ( size_t j = i; j < n; ++j ) {
+            hess[i * n + j] = hess[j * n + i] = *upper++;
+        }
+    }
+
+    return out[0];
+}
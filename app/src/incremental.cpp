@@ -0,0 +1,169 @@
+// src/incremental.cpp
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "incremental.hpp"
+#include "ast.hpp"
+#include "intern.hpp"
+#include "parser.hpp"
+#include "simplify.hpp"
+#include "tokenizer.hpp"
+
+
+
+namespace {
+
+// Below this many nodes a rebuild is cheap, so the factory is not compacted
+const size_t compactSlack = 1 << 12;
+
+} // namespace
+
+
+
+IncrementalDifferentiator::IncrementalDifferentiator() = default;
+
+IncrementalDifferentiator::~IncrementalDifferentiator() = default;
+
+void IncrementalDifferentiator::clear() {
+    text.clear();
+    groups.clear();
+    factory.reset();
+    simplifier.reset();
+    derivs.reset();
+    freshSize = 0;
+}
+
+NodePtr IncrementalDifferentiator::tree(int order) const {
+    if ( order < 0 || order > 2 || !trees[order] ) {
+        throw std::runtime_error("No tree of order " + std::to_string(order));
+    }
+    return trees[order];
+}
+
+// The stages of Expression (parse, simplify, differentiate, simplify, ...),
+// each interned, so unchanged subtrees are the canonical nodes the memos
+// of the simplifier and of the derivatives already hold
+std::tuple<Func, Func, Func> IncrementalDifferentiator::update(const std::string &mathExpr) {
+    if ( factory && factory -> size() > compactFactor * freshSize + compactSlack ) {
+        clear();
+    }
+
+    IncrementalStats stats;
+    stats.rebuilt = !factory;
+    if ( !factory ) {
+        factory = std::make_unique<NodeFactory>();
+        simplifier = std::make_unique<SimplifyCache>();
+        derivs = std::make_unique<DerivCache>();
+    }
+
+    std::vector<Parser::ParsedGroup> next;
+    NodePtr parsed = parse(mathExpr, next, stats);
+
+    size_t nodesBefore = factory -> size();
+    size_t derivsBefore = derivs -> size();
+
+    // The parse is dropped after this update, so only the canonical forms of
+    // it and of its groups are kept
+    std::vector<NodePtr> groupTrees;
+    groupTrees.reserve(next.size());
+    for ( const Parser::ParsedGroup &group : next ) {
+        groupTrees.push_back(group.tree);
+    }
+    NodePtr root = factory -> internTemporary(parsed, groupTrees);
+    for ( size_t i = 0; i < next.size(); ++i ) {
+        next[i].tree = std::move(groupTrees[i]);
+    }
+
+    NodePtr built[3];
+    built[0] = factory -> intern(simplifier -> simplify(root));
+    for ( int order = 1; order < 3; ++order ) {
+        built[order] = factory -> intern(simplifier -> simplify(factory -> intern(derivs -> deriv(built[order - 1]))));
+    }
+
+    stats.newNodes = factory -> size() - nodesBefore;
+    stats.newDerivatives = derivs -> size() - derivsBefore;
+    stats.retained = factory -> retained();
+    if ( stats.rebuilt ) {
+        freshSize = factory -> size();
+    }
+
+    text = mathExpr;
+    groups = std::move(next);
+    for ( int order = 0; order < 3; ++order ) {
+        trees[order] = built[order];
+    }
+    last = stats;
+
+    Func f = [tree = built[0]](Complex x) { return tree -> eval(x); };
+    Func f1 = [tree = built[1]](Complex x) { return tree -> eval(x); };
+    Func f2 = [tree = built[2]](Complex x) { return tree -> eval(x); };
+
+    return std::make_tuple(f, f1, f2);
+}
+
+// Only the changed range differs from text: the groups wholly before it
+// keep their offsets, those wholly after it move by the change in length.
+// The outermost of them become Group tokens; the text between is tokenized.
+NodePtr IncrementalDifferentiator::parse(const std::string &mathExpr, std::vector<Parser::ParsedGroup> &next, IncrementalStats &stats) {
+    size_t common = std::min(text.size(), mathExpr.size());
+    size_t prefix = 0;
+    while ( prefix < common && text[prefix] == mathExpr[prefix] ) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while ( suffix < common - prefix && text[text.size() - 1 - suffix] == mathExpr[mathExpr.size() - 1 - suffix] ) {
+        ++suffix;
+    }
+
+    std::vector<Parser::ParsedGroup> kept;
+    for ( const Parser::ParsedGroup &group : groups ) {
+        if ( group.end <= prefix ) {
+            kept.push_back(group);
+        }
+        else if ( group.begin >= text.size() - suffix ) {
+            size_t begin = group.begin - text.size() + mathExpr.size();
+            kept.push_back({ begin, begin + ( group.end - group.begin ), group.tree });
+        }
+    }
+
+    // Outer groups before the groups nested in them
+    std::sort(kept.begin(), kept.end(), [](const Parser::ParsedGroup &a, const Parser::ParsedGroup &b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    });
+
+    std::string_view input(mathExpr);
+    std::vector<Token> tokens;
+    std::vector<NodePtr> reused;
+    size_t pos = 0;
+
+    for ( const Parser::ParsedGroup &group : kept ) {
+        if ( group.begin < pos ) {
+            continue;   // Inside a group already reused
+        }
+        tokenizeRange(input, pos, group.begin, tokens);
+        stats.parsedBytes += group.begin - pos;
+
+        Token token{ TokenKind::Group, input.substr(group.begin, group.end - group.begin), group.begin };
+        token.group = static_cast<std::uint32_t>(reused.size());
+        tokens.push_back(token);
+        reused.push_back(group.tree);
+        pos = group.end;
+    }
+    tokenizeRange(input, pos, input.size(), tokens);
+    stats.parsedBytes += input.size() - pos;
+    tokens.push_back({ TokenKind::End, input.substr(input.size()), input.size() });
+    stats.reusedGroups = reused.size();
+
+    Parser parser(std::move(tokens), std::move(reused));
+    parser.recordGroups(&next);
+    NodePtr tree = parser.parse();
+
+    // The groups parsed now, and every group kept, nested ones included, for the next edit
+    next.insert(next.end(), kept.begin(), kept.end());
+    return tree;
+}
@@ -0,0 +1,243 @@
+// src/intern.cpp
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#include "intern.hpp"
+#include "ast.hpp"
+#include "arena.hpp"
+
+
+
+namespace {
+
+enum Kind : std::uint8_t { Constant, Variable, Binary, Power, IntPower, Function, Polynomial };
+
+void hashCombine(size_t &seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+// Equal values with equal signs, so that 0.0 and -0.0 stay distinct, in both parts
+bool sameValue(const Complex &a, const Complex &b) {
+    return a == b
+        && std::signbit(a.real()) == std::signbit(b.real())
+        && std::signbit(a.imag()) == std::signbit(b.imag());
+}
+
+} // namespace
+
+
+
+bool NodeFactory::Key::operator==(const Key &other) const {
+    if ( kind != other.kind || op != other.op || !sameValue(value, other.value) || a != other.a || b != other.b ) {
+        return false;
+    }
+    if ( !coeffs || !other.coeffs ) {
+        return coeffs == other.coeffs;
+    }
+    if ( coeffs -> size() != other.coeffs -> size() ) {
+        return false;
+    }
+
+    for ( size_t k = 0; k < coeffs -> size(); ++k ) {
+        if ( !sameValue((*coeffs)[k], (*other.coeffs)[k]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t NodeFactory::KeyHash::operator()(const Key &key) const {
+    size_t seed = key.kind;
+    hashCombine(seed, std::hash<char>()(key.op));
+    hashCombine(seed, std::hash<long double>()(key.value.real()));
+    hashCombine(seed, std::hash<long double>()(key.value.imag()));
+    hashCombine(seed, std::hash<const Node *>()(key.a));
+    hashCombine(seed, std::hash<const Node *>()(key.b));
+    if ( key.coeffs ) {
+        for ( const Complex &c : *key.coeffs ) {
+            hashCombine(seed, std::hash<long double>()(c.real()));
+            hashCombine(seed, std::hash<long double>()(c.imag()));
+        }
+    }
+
+    return seed;
+}
+
+
+
+NodePtr NodeFactory::constant(const Complex &value) {
+    Key key{ Constant, 0, value, nullptr, nullptr };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = makeNode<ConstNode>(value);
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::variable(std::uint32_t index) {
+    Key key{ Variable, 0, static_cast<long double>(index), nullptr, nullptr };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = makeNode<VarNode>(index);
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::binary(char op, NodePtr l, NodePtr r) {
+    Key key{ Binary, op, 0.0, l.get(), r.get() };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = folded(makeNode<BinaryNode>(op, std::move(l), std::move(r)));
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::power(NodePtr b, NodePtr e) {
+    Key key{ Power, 0, 0.0, b.get(), e.get() };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = folded(makeNode<PowerNode>(std::move(b), std::move(e)));
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::intPower(NodePtr b, std::int32_t n) {
+    Key key{ IntPower, 0, static_cast<long double>(n), b.get(), nullptr };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = folded(makeNode<IntPowerNode>(std::move(b), n));
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::func(FuncId id, NodePtr arg) {
+    Key key{ Function, static_cast<char>(id), 0.0, arg.get(), nullptr };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = folded(makeNode<FuncNode>(id, std::move(arg)));
+    nodes.emplace(std::move(key), node);
+    return node;
+}
+
+NodePtr NodeFactory::poly(NodePtr arg, std::vector<Complex> coeffs) {
+    Key key{ Polynomial, 0, 0.0, arg.get(), nullptr, &coeffs };
+    auto found = nodes.find(key);
+    if ( found != nodes.end() ) {
+        return found -> second;
+    }
+
+    NodePtr node = folded(makeNode<PolyNode>(std::move(arg), std::move(coeffs)));
+    // The stored key refers to the coefficients of the node it maps to, so
+    // a polynomial folded into a constant is not cached (its constant is)
+    if ( auto stored = dynamic_cast<const PolyNode *>(node.get()) ) {
+        key.coeffs = &stored -> coeffs;
+        nodes.emplace(std::move(key), node);
+    }
+    return node;
+}
+
+
+// Rebuild a tree through the factory. Children are interned first (by an
+// explicit-stack walk), so keys only ever refer to canonical nodes and
+// equal subtrees collapse into one. Canonical nodes are their own canonical
+// form, so a tree built on them is walked only down to them.
+NodePtr NodeFactory::intern(const NodePtr &tree) {
+    auto found = interned.find(tree.get());
+    if ( found != interned.end() ) {
+        return found -> second;
+    }
+
+    // Keep the input alive, so addresses memoized in `interned` cannot be reused
+    inputs.push_back(tree);
+    walk(tree, nullptr);
+
+    return interned.at(tree.get());
+}
+
+// The entries of tree's nodes are erased before they can be freed, so no
+// address in `interned` outlives its node
+NodePtr NodeFactory::internTemporary(const NodePtr &tree, std::vector<NodePtr> &subtrees) {
+    std::vector<const Node *> added;
+    walk(tree, &added);
+
+    NodePtr result = interned.at(tree.get());
+    for ( NodePtr &subtree : subtrees ) {
+        subtree = interned.at(subtree.get());
+    }
+    for ( const Node *node : added ) {
+        interned.erase(node);
+    }
+
+    return result;
+}
+
+void NodeFactory::walk(const NodePtr &tree, std::vector<const Node *> *added) {
+    postOrder(tree,
+        [&](const Node *node) { return interned.count(node) != 0; },
+        [&](const NodePtr &node) {
+            NodePtr canonical = internNode(node);
+            interned.emplace(canonical.get(), canonical);
+            if ( canonical != node && added ) {
+                added -> push_back(node.get());
+            }
+            interned.emplace(node.get(), std::move(canonical));
+        });
+}
+
+// Canonical node for one node whose operands are already interned
+NodePtr NodeFactory::internNode(const NodePtr &tree) {
+    NodePtr node;
+
+    if ( auto constant = dynamic_cast<const ConstNode *>(tree.get()) ) {
+        node = this -> constant(constant -> value);
+    }
+    else if ( auto var = dynamic_cast<const VarNode *>(tree.get()) ) {
+        node = variable(var -> index);
+    }
+    else if ( auto binary = dynamic_cast<const BinaryNode *>(tree.get()) ) {
+        node = this -> binary(binary -> op, interned.at(binary -> left.get()), interned.at(binary -> right.get()));
+    }
+    else if ( auto power = dynamic_cast<const PowerNode *>(tree.get()) ) {
+        node = this -> power(interned.at(power -> base.get()), interned.at(power -> exp.get()));
+    }
+    else if ( auto power = dynamic_cast<const IntPowerNode *>(tree.get()) ) {
+        node = intPower(interned.at(power -> base.get()), power -> n);
+    }
+    else if ( auto func = dynamic_cast<const FuncNode *>(tree.get()) ) {
+        node = this -> func(func -> func, interned.at(func -> arg.get()));
+    }
+    else if ( auto poly = dynamic_cast<const PolyNode *>(tree.get()) ) {
+        node = this -> poly(interned.at(poly -> arg.get()), poly -> coeffs);
+    }
+    else {
+        throw std::runtime_error("Cannot intern node");
+    }
+
+    return node;
+}
+
+// The operands are canonical, so a constant node here has only constant
+// operands; the key of the operation then maps straight to the folded constant
+NodePtr NodeFactory::folded(const NodePtr &node) {
+    return node -> constant ? constant(node -> eval(Complex(0.0, 0.0))) : node;
+}
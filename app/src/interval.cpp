@@ -0,0 +1,377 @@
+// src/interval.cpp
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "interval.hpp"
+
+
+
+namespace {
+
+using Limits = std::numeric_limits<long double>;
+
+const long double pi = 3.141592653589793238462643383279502884L;
+const long double halfPi = 1.570796326794896619231321691639751442L;
+
+// Slack of the libm calls, in units of the last place
+const int libmUlps = 4;
+
+
+// [lo, hi] moved outward by ulps units of the last place; NaN widens to
+// the whole line, and an overflowed bound stays on the finite side it belongs to
+Interval round(long double lo, long double hi, int ulps = 1) {
+    if ( std::isnan(lo) || std::isnan(hi) ) {
+        return interval::entire();
+    }
+
+    if ( std::isfinite(lo) )  lo -= std::fabs(lo) * Limits::epsilon() * ulps + Limits::denorm_min();
+    if ( std::isfinite(hi) )  hi += std::fabs(hi) * Limits::epsilon() * ulps + Limits::denorm_min();
+    if ( lo == Limits::infinity() )  lo = Limits::max();
+    if ( hi == -Limits::infinity() )  hi = -Limits::max();
+
+    return { lo, hi };
+}
+
+Interval point(long double v) {
+    return round(v, v);
+}
+
+Interval clamp(Interval x, long double lo, long double hi) {
+    return { std::max(x.lo, lo), std::min(x.hi, hi) };
+}
+
+Interval hull(Interval a, Interval b) {
+    return { std::min(a.lo, b.lo), std::max(a.hi, b.hi) };
+}
+
+Interval neg(Interval a) {
+    return { -a.hi, -a.lo };
+}
+
+// Exact zeros pass through unrounded, so the zero derivatives of
+// constants stay exact through the arithmetic below
+Interval add(Interval a, Interval b) {
+    if ( a.isZero() )  return b;
+    if ( b.isZero() )  return a;
+    return round(a.lo + b.lo, a.hi + b.hi);
+}
+
+Interval sub(Interval a, Interval b) {
+    if ( b.isZero() )  return a;
+    if ( a.isZero() )  return neg(b);
+    return round(a.lo - b.hi, a.hi - b.lo);
+}
+
+// An exact zero factor gives zero even against an unbounded one: the
+// operands are finite at every point, only their bounds are not
+Interval mul(Interval a, Interval b) {
+    if ( a.isZero() || b.isZero() ) {
+        return { 0.0, 0.0 };
+    }
+
+    long double p[4] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+    for ( long double v : p ) {
+        if ( std::isnan(v) )  return interval::entire();
+    }
+
+    return round(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+}
+
+Interval sqr(Interval a) {
+    if ( a.isZero() ) {
+        return a;
+    }
+
+    long double l = a.lo * a.lo, h = a.hi * a.hi;
+    if ( a.contains(0.0) ) {
+        return round(0.0, std::max(l, h));
+    }
+
+    return round(std::min(l, h), std::max(l, h));
+}
+
+// a / b for b not containing 0
+Interval div(Interval a, Interval b) {
+    if ( b.contains(0.0) ) {
+        return interval::entire();
+    }
+
+    long double q[4] = { a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi };
+    for ( long double v : q ) {
+        if ( std::isnan(v) )  return interval::entire();
+    }
+
+    return round(*std::min_element(q, q + 4), *std::max_element(q, q + 4));
+}
+
+
+// Real functions, named apart from the <cmath> overloads
+namespace real {
+
+// Monotone functions: the bounds are the images of the bounds
+
+Interval exp(Interval x) {
+    Interval r = round(std::exp(x.lo), std::exp(x.hi), libmUlps);
+    return { std::max(r.lo, 0.0L), r.hi };
+}
+
+// log over the part of x at or above 0
+Interval log(Interval x) {
+    long double lo = ( x.lo > 0.0 ) ? std::log(x.lo) : -Limits::infinity();
+    return round(lo, std::log(x.hi), libmUlps);
+}
+
+Interval sinh(Interval x) {
+    return round(std::sinh(x.lo), std::sinh(x.hi), libmUlps);
+}
+
+// Decreasing below 0, increasing above
+Interval cosh(Interval x) {
+    long double l = std::cosh(x.lo), h = std::cosh(x.hi);
+    if ( x.contains(0.0) ) {
+        return clamp(round(1.0, std::max(l, h), libmUlps), 1.0, Limits::infinity());
+    }
+
+    return round(std::min(l, h), std::max(l, h), libmUlps);
+}
+
+
+// Range of sin (phase pi/2) or cos (phase 0) over x: the values at the
+// ends, and 1 or -1 if x holds one of the extrema at phase + n pi (a
+// maximum for even n). A wide or very large x just gets [-1, 1].
+template <typename F>
+Interval trig(Interval x, F f, long double phase) {
+    const Interval whole = { -1.0, 1.0 };
+    if ( !std::isfinite(x.lo) || !std::isfinite(x.hi) || x.hi - x.lo >= 2 * pi ) {
+        return whole;
+    }
+    if ( std::max(std::fabs(x.lo), std::fabs(x.hi)) > 1e15L ) {
+        return whole;
+    }
+
+    long double a = f(x.lo), b = f(x.hi);
+    long double lo = std::min(a, b), hi = std::max(a, b);
+
+    // Rounding of n near an extremum errs towards including it
+    long double slack = 8 * Limits::epsilon() * ( std::max(std::fabs(x.lo), std::fabs(x.hi)) / pi + 1 );
+    long double first = std::ceil(( x.lo - phase ) / pi - slack);
+    long double last = std::floor(( x.hi - phase ) / pi + slack);
+
+    for ( long double n = first; n <= last; n += 1 ) {
+        if ( std::fmod(std::fabs(n), 2.0L) == 0 ) {
+            hi = 1.0;
+        }
+        else {
+            lo = -1.0;
+        }
+    }
+
+    return clamp(round(lo, hi, libmUlps), -1.0, 1.0);
+}
+
+Interval sin(Interval x) {
+    return trig(x, [](long double v) { return std::sin(v); }, halfPi);
+}
+
+Interval cos(Interval x) {
+    return trig(x, [](long double v) { return std::cos(v); }, 0.0);
+}
+
+} // namespace real
+
+
+// |z| over the box: from the point nearest to 0 to the farthest corner
+Interval modulus(const Box &z) {
+    auto nearest = [](Interval x) { return x.contains(0.0) ? 0.0L : std::min(std::fabs(x.lo), std::fabs(x.hi)); };
+    auto farthest = [](Interval x) { return std::max(std::fabs(x.lo), std::fabs(x.hi)); };
+
+    Interval r = round(std::hypot(nearest(z.re), nearest(z.im)), std::hypot(farthest(z.re), farthest(z.im)), libmUlps);
+    return { std::max(r.lo, 0.0L), r.hi };
+}
+
+// arg z over the box. Off the negative real axis (and 0) arg is continuous
+// on the box, and a convex set seen from outside spans the angles of its corners.
+Interval argument(const Box &z) {
+    const Interval whole = round(-pi, pi);
+    if ( z.re.lo < 0.0 && z.im.contains(0.0) ) {
+        return whole;
+    }
+    if ( z.containsZero() ) {
+        return whole;
+    }
+
+    long double corners[4] = {
+        std::atan2(z.im.lo, z.re.lo), std::atan2(z.im.lo, z.re.hi),
+        std::atan2(z.im.hi, z.re.lo), std::atan2(z.im.hi, z.re.hi)
+    };
+    Interval r = round(*std::min_element(corners, corners + 4), *std::max_element(corners, corners + 4), libmUlps);
+    return clamp(r, whole.lo, whole.hi);
+}
+
+// r (cos phi + i sin phi) for r >= 0
+Box polar(Interval r, Interval phi) {
+    return Box(mul(r, real::cos(phi)), mul(r, real::sin(phi)));
+}
+
+Box hull(const Box &a, const Box &b) {
+    return Box(hull(a.re, b.re), hull(a.im, b.im));
+}
+
+// i z and -i z
+Box timesI(const Box &z) {
+    return Box(neg(z.im), z.re);
+}
+
+Box timesMinusI(const Box &z) {
+    return Box(z.im, neg(z.re));
+}
+
+Box one() {
+    return Box(Complex(1.0));
+}
+
+} // namespace
+
+
+
+Box operator+(const Box &a, const Box &b) {
+    return Box(add(a.re, b.re), add(a.im, b.im));
+}
+
+Box operator-(const Box &a, const Box &b) {
+    return Box(sub(a.re, b.re), sub(a.im, b.im));
+}
+
+Box operator-(const Box &a) {
+    return Box(neg(a.re), neg(a.im));
+}
+
+// (a + ib)(c + id) = (ac - bd) + i (ad + bc)
+Box operator*(const Box &a, const Box &b) {
+    return Box(sub(mul(a.re, b.re), mul(a.im, b.im)), add(mul(a.re, b.im), mul(a.im, b.re)));
+}
+
+// a / b = a conj(b) / |b|^2
+Box operator/(const Box &a, const Box &b) {
+    Interval norm = add(sqr(b.re), sqr(b.im));
+    if ( norm.lo <= 0.0 ) {
+        return interval::plane();
+    }
+
+    return a * Box(div(b.re, norm), neg(div(b.im, norm)));
+}
+
+
+
+namespace interval {
+
+Interval entire() {
+    return { -Limits::infinity(), Limits::infinity() };
+}
+
+Box plane() {
+    return Box(entire(), entire());
+}
+
+// (a + ib)^2 = (a^2 - b^2) + 2iab
+Box sqr(const Box &a) {
+    Interval cross = mul(a.re, a.im);
+    return Box(sub(::sqr(a.re), ::sqr(a.im)), add(cross, cross));
+}
+
+// Repeated squaring as ::powInt, so u^0 = 1 and u^-n = 1 / u^n
+Box powInt(const Box &a, std::int32_t n) {
+    std::uint32_t k = ( n < 0 ) ? 0u - static_cast<std::uint32_t>(n) : static_cast<std::uint32_t>(n);
+    Box result = one(), power = a;
+    bool started = false;
+
+    while ( k ) {
+        if ( k & 1u ) {
+            result = started ? result * power : power;
+            started = true;
+        }
+        k >>= 1;
+        if ( k ) {
+            power = sqr(power);
+        }
+    }
+
+    return ( n < 0 ) ? one() / result : result;
+}
+
+// std::pow takes 0^b as 0
+Box pow(const Box &a, const Box &b) {
+    Box p = exp(b * log(a));
+    return a.containsZero() ? ::hull(p, Box(Complex(0.0))) : p;
+}
+
+// e^(a + ib) = e^a (cos b + i sin b)
+Box exp(const Box &a) {
+    return polar(real::exp(a.re), a.im);
+}
+
+// log z = log|z| + i arg z
+Box log(const Box &a) {
+    return Box(real::log(modulus(a)), argument(a));
+}
+
+// sqrt z = sqrt|z| (cos(arg z / 2) + i sin(arg z / 2))
+Box sqrt(const Box &a) {
+    Interval r = modulus(a);
+    Interval phi = argument(a);
+
+    Interval root = round(std::sqrt(r.lo), std::sqrt(r.hi), libmUlps);
+    return polar({ std::max(root.lo, 0.0L), root.hi }, round(phi.lo / 2, phi.hi / 2));
+}
+
+// sin(a + ib) = sin a cosh b + i cos a sinh b
+Box sin(const Box &a) {
+    return Box(mul(real::sin(a.re), real::cosh(a.im)), mul(real::cos(a.re), real::sinh(a.im)));
+}
+
+// cos(a + ib) = cos a cosh b - i sin a sinh b
+Box cos(const Box &a) {
+    return Box(mul(real::cos(a.re), real::cosh(a.im)), neg(mul(real::sin(a.re), real::sinh(a.im))));
+}
+
+Box tan(const Box &a) {
+    return sin(a) / cos(a);
+}
+
+Box cot(const Box &a) {
+    return cos(a) / sin(a);
+}
+
+// sinh(a + ib) = sinh a cos b + i cosh a sin b
+Box sinh(const Box &a) {
+    return Box(mul(real::sinh(a.re), real::cos(a.im)), mul(real::cosh(a.re), real::sin(a.im)));
+}
+
+// cosh(a + ib) = cosh a cos b + i sinh a sin b
+Box cosh(const Box &a) {
+    return Box(mul(real::cosh(a.re), real::cos(a.im)), mul(real::sinh(a.re), real::sin(a.im)));
+}
+
+Box tanh(const Box &a) {
+    return sinh(a) / cosh(a);
+}
+
+// asin z = -i log(iz + sqrt(1 - z^2))
+Box asin(const Box &a) {
+    return timesMinusI(log(timesI(a) + sqrt(one() - sqr(a))));
+}
+
+// acos z = pi/2 - asin z
+Box acos(const Box &a) {
+    return Box(point(halfPi), { 0.0, 0.0 }) - asin(a);
+}
+
+// atan z = (i/2) (log(1 - iz) - log(1 + iz))
+Box atan(const Box &a) {
+    Box d = log(one() - timesI(a)) - log(one() + timesI(a));
+    return Box(point(0.5), { 0.0, 0.0 }) * timesI(d);
+}
+
+} // namespace interval
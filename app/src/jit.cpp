@@ -0,0 +1,369 @@
+// src/jit.cpp
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef DIFF_ENABLE_JIT
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "jit.hpp"
+#include "ast.hpp"
+#include "functions.hpp"
+
+
+
+namespace {
+
+// C expression applying g to the temporary `arg`, matching applyFunc()
+std::string callC(FuncId id, const std::string &arg) {
+    switch (id) {
+        case FuncId::Sin:   return "csinl(" + arg + ")";
+        case FuncId::Cos:   return "ccosl(" + arg + ")";
+        case FuncId::Tan:   return "ctanl(" + arg + ")";
+        case FuncId::Cot:   return "CMPLXL(1.0L, 0.0L) / ctanl(" + arg + ")";
+        case FuncId::Log:   return "clogl(" + arg + ")";
+        case FuncId::Exp:   return "cexpl(" + arg + ")";
+        case FuncId::Sqrt:  return "csqrtl(" + arg + ")";
+        case FuncId::Sinh:  return "csinhl(" + arg + ")";
+        case FuncId::Cosh:  return "ccoshl(" + arg + ")";
+        case FuncId::Tanh:  return "ctanhl(" + arg + ")";
+        case FuncId::Asin:  return "casinl(" + arg + ")";
+        case FuncId::Acos:  return "cacosl(" + arg + ")";
+        case FuncId::Atan:  return "catanl(" + arg + ")";
+    }
+
+    throw std::runtime_error("Unknown func");
+}
+
+// C literal for one part of a constant; hexadecimal, so it is reproduced bit for bit
+std::string literalC(long double value) {
+    char literal[64];
+    if ( std::isnan(value) ) {
+        std::snprintf(literal, sizeof(literal), "NAN");
+    }
+    else if ( std::isinf(value) ) {
+        std::snprintf(literal, sizeof(literal), "%sINFINITY", value < 0 ? "-" : "");
+    }
+    else {
+        std::snprintf(literal, sizeof(literal), "%LaL", value);
+    }
+    return literal;
+}
+
+
+// Lowers one tree to straight-line C, one temporary per unique node
+class SourceBuilder {
+public:
+    explicit SourceBuilder(std::ostringstream &out) : out(out) {}
+
+    // Define every node of tree not defined yet, operands first; returns the root's temporary
+    std::string emit(const NodePtr &tree);
+
+private:
+    std::ostringstream &out;
+    std::unordered_map<const Node *, std::string> emitted;  // node -> temporary
+
+    std::string emitNode(const Node *node);
+
+    std::string define(const std::string &value);
+};
+
+std::string SourceBuilder::define(const std::string &value) {
+    std::string name = "t" + std::to_string(emitted.size());
+    out << "    const cx " << name << " = " << value << ";\n";
+
+    return name;
+}
+
+std::string SourceBuilder::emit(const NodePtr &tree) {
+    postOrder(tree,
+        [&](const Node *node) { return emitted.count(node) != 0; },
+        [&](const NodePtr &node) {
+            std::string name = emitNode(node.get());
+            emitted.emplace(node.get(), name);
+        });
+
+    return emitted.at(tree.get());
+}
+
+// One definition for a node whose operands are already defined
+std::string SourceBuilder::emitNode(const Node *node) {
+    std::string value;
+
+    if ( auto constant = dynamic_cast<const ConstNode *>(node) ) {
+        value = "CMPLXL(" + literalC(constant -> value.real()) + ", " + literalC(constant -> value.imag()) + ")";
+    }
+    else if ( auto var = dynamic_cast<const VarNode *>(node) ) {
+        // The generated functions take x alone
+        if ( var -> index != 0 ) {
+            throw std::runtime_error("JIT compiles expressions in x only");
+        }
+        value = "x";
+    }
+    else if ( auto binary = dynamic_cast<const BinaryNode *>(node) ) {
+        const std::string &a = emitted.at(binary -> left.get());
+        const std::string &b = emitted.at(binary -> right.get());
+
+        switch (binary -> op) {
+            case '+': case '-': case '*': case '/':
+                value = a + " " + binary -> op + " " + b;
+                break;
+            default:
+                throw std::runtime_error("Unknown binary op");
+        }
+    }
+    else if ( auto power = dynamic_cast<const PowerNode *>(node) ) {
+        const std::string &a = emitted.at(power -> base.get());
+        const std::string &b = emitted.at(power -> exp.get());
+        value = "cpowl(" + a + ", " + b + ")";
+    }
+    else if ( auto power = dynamic_cast<const IntPowerNode *>(node) ) {
+        value = "diff_powi(" + emitted.at(power -> base.get()) + ", " + std::to_string(power -> n) + ")";
+    }
+    else if ( auto func = dynamic_cast<const FuncNode *>(node) ) {
+        value = callC(func -> func, emitted.at(func -> arg.get()));
+    }
+    else if ( auto poly = dynamic_cast<const PolyNode *>(node) ) {
+        // horner() from ast.hpp: ((c_n * u + c_n-1) * u + ...) + c_0
+        const std::string &u = emitted.at(poly -> arg.get());
+        const std::vector<Complex> &c = poly -> coeffs;
+
+        value = "CMPLXL(" + literalC(c.back().real()) + ", " + literalC(c.back().imag()) + ")";
+        for ( size_t k = poly -> degree(); k-- > 0; ) {
+            value = "(" + value + ") * " + u + " + CMPLXL(" + literalC(c[k].real()) + ", " + literalC(c[k].imag()) + ")";
+        }
+    }
+    else {
+        throw std::runtime_error("Cannot compile node to C");
+    }
+
+    return define(value);
+}
+
+} // namespace
+
+
+
+std::string JitModule::generateSource(const std::vector<NodePtr> &trees) {
+    std::ostringstream out;
+    out << "#include <complex.h>\n"
+        << "#include <math.h>\n"
+        << "#include <stddef.h>\n\n"
+        << "typedef long double _Complex cx;\n\n"
+        // powInt() from ast.hpp, operation for operation
+        << "static cx diff_powi(cx u, long n) {\n"
+        << "    unsigned long k = n < 0 ? 0ul - (unsigned long)n : (unsigned long)n;\n"
+        << "    cx result = CMPLXL(1.0L, 0.0L), power = u;\n"
+        << "    int started = 0;\n"
+        << "    while ( k ) {\n"
+        << "        if ( k & 1ul ) { result = started ? result * power : power; started = 1; }\n"
+        << "        k >>= 1;\n"
+        << "        if ( k ) power = power * power;\n"
+        << "    }\n"
+        << "    if ( !started ) return CMPLXL(1.0L, 0.0L);\n"
+        << "    return n < 0 ? CMPLXL(1.0L, 0.0L) / result : result;\n"
+        << "}\n";
+
+    for ( size_t i = 0; i < trees.size(); ++i ) {
+        std::string fn = "diff_f" + std::to_string(i);
+
+        out << "\nstatic cx " << fn << "_eval(const cx x) {\n";
+        SourceBuilder builder(out);
+        std::string result = builder.emit(trees[i]);
+        out << "    return " << result << ";\n}\n";
+
+        // Points cross the boundary as (re, im) pairs, the layout of std::complex<long double>
+        out << "\nvoid " << fn << "(const long double *in, long double *out) {\n"
+            << "    cx r = " << fn << "_eval(CMPLXL(in[0], in[1]));\n"
+            << "    out[0] = creall(r);\n"
+            << "    out[1] = cimagl(r);\n"
+            << "}\n";
+
+        out << "\nvoid " << fn << "_batch(const long double *in, long double *out, size_t n) {\n"
+            << "    for ( size_t j = 0; j < n; ++j ) {\n"
+            << "        " << fn << "(in + 2 * j, out + 2 * j);\n"
+            << "    }\n"
+            << "}\n";
+    }
+
+    return out.str();
+}
+
+Complex JitModule::eval(size_t output, const Complex &x) const {
+    Complex result;
+    scalar.at(output)(reinterpret_cast<const long double *>(&x), reinterpret_cast<long double *>(&result));
+
+    return result;
+}
+
+void JitModule::evalBatch(size_t output, const Complex *in, Complex *out, size_t n) const {
+    batch.at(output)(reinterpret_cast<const long double *>(in), reinterpret_cast<long double *>(out), n);
+}
+
+
+#ifdef DIFF_ENABLE_JIT
+
+namespace {
+
+// FNV-1a, stable across runs and builds so it can name cache files
+std::uint64_t fnv1a(const std::string &text) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for ( unsigned char c : text ) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+std::string envOr(const char *name, const std::string &fallback) {
+    const char *value = std::getenv(name);
+    return ( value && *value ) ? value : fallback;
+}
+
+// Objects found in the cache are loaded as they are, and their names are a
+// hash anyone can compute, so only a directory nobody else can write to is
+// used: a real directory (not a symlink) owned by this user, mode 0700
+std::string cacheDirectory() {
+    std::string fallback = envOr("TMPDIR", "/tmp") + "/differentiate-jit-" + std::to_string(::geteuid());
+    std::string dir = envOr("DIFF_JIT_CACHE", fallback);
+
+    if ( ::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST ) {
+        throw std::runtime_error("JIT: cannot create cache directory " + dir + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if ( ::lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)
+      || info.st_uid != ::geteuid() || ( info.st_mode & 0777 ) != 0700 ) {
+        throw std::runtime_error("JIT: cache directory " + dir + " is not a directory of this user with mode 0700");
+    }
+
+    return dir;
+}
+
+// A new empty file stem.XXXXXX<suffix> of this process only, mode 0600
+std::string makeTemp(const std::string &stem, const char *suffix) {
+    std::string name = stem + ".XXXXXX" + suffix;
+    int fd = ::mkstemps(&name[0], static_cast<int>(std::strlen(suffix)));
+    if ( fd < 0 ) {
+        throw std::runtime_error("JIT: cannot create " + name + ": " + std::strerror(errno));
+    }
+    ::close(fd);
+
+    return name;
+}
+
+bool fileExists(const std::string &path) {
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0;
+}
+
+// Build source into the shared object at path, unless a cached one exists
+void buildObject(const std::string &source, const std::string &compiler, const std::string &path) {
+    if ( fileExists(path) ) {
+        return;
+    }
+
+    // Build under unique names and rename, so concurrent builders (threads
+    // or processes) never share a file or load a partial one
+    std::string stem = path.substr(0, path.size() - 3);
+    std::string cFile = makeTemp(stem, ".c");
+    std::string tmpObject;
+    try {
+        tmpObject = makeTemp(stem, ".so");
+    }
+    catch (...) {
+        std::remove(cFile.c_str());
+        throw;
+    }
+
+    {
+        std::ofstream file(cFile);
+        file << source;
+        if ( !file ) {
+            std::remove(cFile.c_str());
+            std::remove(tmpObject.c_str());
+            throw std::runtime_error("JIT: cannot write " + cFile);
+        }
+    }
+
+    std::string command = compiler + " -O2 -shared -fPIC -o '" + tmpObject + "' '" + cFile + "' -lm";
+    int status = std::system(command.c_str());
+    std::remove(cFile.c_str());
+
+    if ( status != 0 || std::rename(tmpObject.c_str(), path.c_str()) != 0 ) {
+        std::remove(tmpObject.c_str());
+        throw std::runtime_error("JIT: compilation failed: " + command);
+    }
+}
+
+} // namespace
+
+
+
+bool JitModule::available() {
+    return true;
+}
+
+std::shared_ptr<const JitModule> JitModule::compile(const std::vector<NodePtr> &trees) {
+    std::string source = generateSource(trees);
+    std::string compiler = envOr("DIFF_JIT_CC", "cc");
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(fnv1a(compiler + '\n' + source)));
+    std::string path = cacheDirectory() + "/" + key + ".so";
+
+    buildObject(source, compiler, path);
+
+    std::shared_ptr<JitModule> module(new JitModule());
+    module -> handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if ( !module -> handle ) {
+        throw std::runtime_error(std::string("JIT: ") + ::dlerror());
+    }
+
+    for ( size_t i = 0; i < trees.size(); ++i ) {
+        std::string fn = "diff_f" + std::to_string(i);
+        auto f = reinterpret_cast<ScalarFn>(::dlsym(module -> handle, fn.c_str()));
+        auto b = reinterpret_cast<BatchFn>(::dlsym(module -> handle, (fn + "_batch").c_str()));
+
+        if ( !f || !b ) {
+            throw std::runtime_error("JIT: missing symbol " + fn);
+        }
+        module -> scalar.push_back(f);
+        module -> batch.push_back(b);
+    }
+
+    return module;
+}
+
+JitModule::~JitModule() {
+    if ( handle ) {
+        ::dlclose(handle);
+    }
+}
+
+#else
+
+bool JitModule::available() {
+    return false;
+}
+
+std::shared_ptr<const JitModule> JitModule::compile(const std::vector<NodePtr> &) {
+    throw std::runtime_error("JIT backend not built (make jit)");
+}
+
+JitModule::~JitModule() = default;
+
+#endif // DIFF_ENABLE_JIT
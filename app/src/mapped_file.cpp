@@ -0,0 +1,107 @@
+// src/mapped_file.cpp
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+
+
+namespace {
+
+[[noreturn]] void fail(const std::string &what, const std::string &path) {
+    throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Closes the descriptor on every path out of the factories; the mapping stays valid
+struct Descriptor {
+    int fd;
+    ~Descriptor() { if ( fd >= 0 ) ::close(fd); }
+};
+
+} // namespace
+
+
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : address(std::exchange(other.address, nullptr)), bytes(std::exchange(other.bytes, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if ( this != &other ) {
+        unmap();
+        address = std::exchange(other.address, nullptr);
+        bytes = std::exchange(other.bytes, 0);
+    }
+
+    return *this;
+}
+
+void MappedFile::unmap() {
+    if ( address ) {
+        ::munmap(address, bytes);
+        address = nullptr;
+        bytes = 0;
+    }
+}
+
+MappedFile MappedFile::openRead(const std::string &path) {
+    Descriptor file{ ::open(path.c_str(), O_RDONLY) };
+    if ( file.fd < 0 ) {
+        fail("Cannot open", path);
+    }
+
+    struct stat info;
+    if ( ::fstat(file.fd, &info) != 0 ) {
+        fail("Cannot stat", path);
+    }
+
+    MappedFile mapped;
+    mapped.bytes = static_cast<size_t>(info.st_size);
+    if ( mapped.bytes == 0 ) {
+        return mapped;  // mmap rejects empty mappings
+    }
+
+    mapped.address = ::mmap(nullptr, mapped.bytes, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if ( mapped.address == MAP_FAILED ) {
+        mapped.address = nullptr;
+        fail("Cannot map", path);
+    }
+    ::madvise(mapped.address, mapped.bytes, MADV_SEQUENTIAL);
+
+    return mapped;
+}
+
+MappedFile MappedFile::create(const std::string &path, size_t size) {
+    Descriptor file{ ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+    if ( file.fd < 0 ) {
+        fail("Cannot create", path);
+    }
+    if ( ::ftruncate(file.fd, static_cast<off_t>(size)) != 0 ) {
+        fail("Cannot resize", path);
+    }
+
+    MappedFile mapped;
+    mapped.bytes = size;
+    if ( size == 0 ) {
+        return mapped;
+    }
+
+    mapped.address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+    if ( mapped.address == MAP_FAILED ) {
+        mapped.address = nullptr;
+        fail("Cannot map", path);
+    }
+
+    return mapped;
+}
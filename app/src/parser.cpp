@@ -1,141 +1,209 @@
 // src/parser.cpp
-#include <cctype>
-#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <utility>
 
 #include "parser.hpp"
 #include "ast.hpp"
+#include "arena.hpp"
+#include "functions.hpp"
+#include "tokenizer.hpp"
+
+
+
+namespace {
+
+// Binding strength of a binary operator token, 0 if it is none
+int precedence(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::Plus:
+        case TokenKind::Minus:
+            return 1;
+        case TokenKind::Star:
+        case TokenKind::Slash:
+            return 2;
+        case TokenKind::Caret:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+char opChar(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::Plus:  return '+';
+        case TokenKind::Minus: return '-';
+        case TokenKind::Star:  return '*';
+        default:               return '/';
+    }
+}
+
+} // namespace
 
 
 
 // Grammar Parser
 
 // Constructor
-Parser::Parser(std::string mathExpr) : inputString(std::move(mathExpr)), currPos(0) {}
+Parser::Parser(std::string_view mathExpr) : tokens(tokenize(mathExpr)), currTok(0) {}
+
+Parser::Parser(std::string_view mathExpr, SymbolTable &symbols) : tokens(tokenize(mathExpr)), currTok(0), symbols(&symbols) {}
 
-// Parse full expression and ensure end-of-string
+Parser::Parser(std::vector<Token> t, std::vector<NodePtr> g) : tokens(std::move(t)), currTok(0), groups(std::move(g)) {}
+
+// Alternates between reading an operand and an operator. An operator first
+// reduces every pending operator that binds at least as tightly ('^', being
+// right-associative, only strictly tighter ones), so the tree comes out as
+// the recursive grammar would build it.
 NodePtr Parser::parse() {
-    skipWhitespace();
-    auto result = parseExpression();
-    skipWhitespace();
-    
-    if ( currPos != inputString.size() ) {
-        throw std::runtime_error("Unexpected: " + std::string(1, inputString[currPos]));
-    }
+    operands.clear();
+    pending.clear();
+    operands.reserve(tokens.size() / 2 + 1);
+    pending.reserve(tokens.size() / 2 + 1);
+
+    for (;;) {
+        while ( !parseOperand() ) {}
+
+        // After an operand: close parentheses, then expect an operator
+        while ( peek().kind == TokenKind::RParen && !pending.empty() ) {
+            while ( !pending.empty() && pending.back().kind != TokenKind::LParen ) {
+                reduce();
+            }
 
-    return result;
-}
+            // No parenthesis is open: the ')' is reported as unexpected below
+            if ( pending.empty() ) {
+                break;
+            }
 
-void Parser::skipWhitespace() { 
-    while ( currPos < inputString.size() && isspace(inputString[currPos]) ) { 
-        currPos++; 
-    } 
-}
+            Pending open = pending.back();
+            pending.pop_back();
+            if ( recorded ) {
+                recorded -> push_back({ open.pos, peek().pos + 1, operands.back() });
+            }
+            ++currTok;
 
-// <expression> := <term> { ('+' | '-') <term> }
-NodePtr Parser::parseExpression() {
-    auto node = parseTerm(); 
-    skipWhitespace();
-    
-    while ( currPos < inputString.size() && ( inputString[currPos] == '+' || inputString[currPos] == '-' ) ) {
-        char op = inputString[currPos++]; 
-        NodePtr rightFactor = parseTerm(); 
-        node = std::make_shared<BinaryNode>(op, node, rightFactor); 
-        skipWhitespace();
-    }
+            if ( open.call ) {
+                operands.back() = foldConstant(makeNode<FuncNode>(open.func, std::move(operands.back())));
+            }
+        }
 
-    return node;
-}
+        int prec = precedence(peek().kind);
+        if ( prec == 0 ) {
+            break;
+        }
 
-// <term> := <factor> { ('*' | '/') <factor> }
-NodePtr Parser::parseTerm() {
-    auto node = parseFactor(); 
-    skipWhitespace();
-    
-    while ( currPos < inputString.size() && ( inputString[currPos] == '*' || inputString[currPos] == '/' ) ) {
-        char op = inputString[currPos++]; 
-        NodePtr rightFactor = parseFactor(); 
-        node = std::make_shared<BinaryNode>(op, node, rightFactor); 
-        skipWhitespace();
+        bool rightAssoc = peek().kind == TokenKind::Caret;
+        while ( !pending.empty() && pending.back().kind != TokenKind::LParen ) {
+            int top = precedence(pending.back().kind);
+            if ( top < prec || ( top == prec && rightAssoc ) ) {
+                break;
+            }
+            reduce();
+        }
+
+        pending.push_back({ peek().kind, false, FuncId::Sin });
+        ++currTok;
     }
 
-    return node;
-}
+    while ( !pending.empty() && pending.back().kind != TokenKind::LParen ) {
+        reduce();
+    }
 
-// <factor> := <primary> [ '^' <factor> ]
-NodePtr Parser::parseFactor() {
-    auto node = parseBasic();
-    skipWhitespace();
-    
-    if ( currPos < inputString.size() && inputString[currPos] == '^' ) {
-        ++currPos;
-        auto exp = parseFactor();
-        node = std::make_shared<PowerNode>(node, exp);
-        skipWhitespace();
+    // The innermost parenthesis still open was never closed
+    if ( !pending.empty() ) {
+        throw ParseError(pending.back().call ? "Missing closing ')' for function call"
+                                             : "Missing closing ')' for sub-expression", peek().pos);
+    }
+
+    if ( peek().kind != TokenKind::End ) {
+        throw ParseError("Unexpected: " + std::string(peek().text), peek().pos);
     }
 
-    return node;
+    NodePtr result = std::move(operands.back());
+    operands.clear();
+    return result;
 }
 
 // <basic> := number | 'x' | func_call | '(' <expression> ')'
-NodePtr Parser::parseBasic() {
-    skipWhitespace();
+bool Parser::parseOperand() {
+    const Token &token = peek();
     
-    // Parse numeric constant
-    if ( currPos < inputString.size() && isdigit(inputString[currPos]) ) {
-        std::string num;
-        
-        while ( currPos < inputString.size() && (isdigit(inputString[currPos]) || inputString[currPos] == '.') ) {
-            num += inputString[currPos++];
-        }
-
-        return std::make_shared<ConstNode>(std::stod(num));
+    // Numeric constant, already converted by the tokenizer
+    if ( token.kind == TokenKind::Number ) {
+        ++currTok;
+        operands.push_back(makeNode<ConstNode>(token.value));
+        return true;
     }
 
-    // Parse variable 'x' or function name
-    if ( currPos < inputString.size() && isalpha(inputString[currPos]) ) {
-        std::string id;
-        
-        while ( currPos < inputString.size() && isalpha(inputString[currPos]) ) {
-            id += inputString[currPos++];   
-        }
-        skipWhitespace();
+    // Variable or function name
+    if ( token.kind == TokenKind::Ident ) {
+        ++currTok;
         
-        if ( id == "x" ) {
-            return std::make_shared<VarNode>();
+        if ( token.text == "x" && !symbols ) {
+            operands.push_back(makeNode<VarNode>());
+            return true;
         }
         
-        // Function call ( "sin" | "cos" | "tan" | "cot" | "log" )
-        // name(expr)
-        if ( currPos < inputString.size() && inputString[currPos] == '(' ) { 
-            ++currPos;
-            auto arg = parseExpression();
-            skipWhitespace();
-            
-            if ( currPos >= inputString.size() || inputString[currPos] != ')' ) {
-                throw std::runtime_error("Missing closing ')' for function call");
+        // Function call: name(expr), with name looked up in the function registry
+        if ( peek().kind == TokenKind::LParen || peek().kind == TokenKind::Group ) { 
+            const FuncInfo *info = findFunc(token.text);
+            if ( !info ) {
+                throw ParseError("Unknown function: " + std::string(token.text), token.pos);
             }
-            ++currPos;
 
-            return std::make_shared<FuncNode>(id, std::vector<NodePtr>{arg});
+            // The argument parsed before: the call is complete
+            if ( peek().kind == TokenKind::Group ) {
+                operands.push_back(foldConstant(makeNode<FuncNode>(info -> id, groups.at(peek().group))));
+                ++currTok;
+                return true;
+            }
+
+            pending.push_back({ TokenKind::LParen, true, info -> id, peek().pos });
+            ++currTok;
+            return false;
+        }
+
+        if ( symbols ) {
+            operands.push_back(makeNode<VarNode>(symbols -> declare(token.text)));
+            return true;
         }
 
-        throw std::runtime_error("Unknown identifier: " + id);
+        throw ParseError("Unknown identifier: " + std::string(token.text), token.pos);
     }
 
     // Parenthesized sub-expression
-    if ( currPos < inputString.size() && inputString[currPos] == '(' ) { 
-        ++currPos;
-        auto node = parseExpression();
-        skipWhitespace(); 
-        
-        if ( currPos >= inputString.size() || inputString[currPos] != ')') {
-            throw std::runtime_error("Missing closing ')' for sub-expression");
-        }
-        ++currPos;
-        
-        return node;
+    if ( token.kind == TokenKind::LParen ) { 
+        ++currTok;
+        pending.push_back({ TokenKind::LParen, false, FuncId::Sin, token.pos });
+        return false;
     }
 
-    throw std::runtime_error(std::string("Unexpected char: ") + inputString[currPos]);
+    // One parsed before
+    if ( token.kind == TokenKind::Group ) {
+        ++currTok;
+        operands.push_back(groups.at(token.group));
+        return true;
+    }
+
+    if ( token.kind == TokenKind::End ) {
+        throw ParseError("Unexpected end of input", token.pos);
+    }
+
+    throw ParseError("Unexpected: " + std::string(token.text), token.pos);
+}
+
+// <term> / <expression> / <factor>: left op right for the topmost operator
+void Parser::reduce() {
+    TokenKind op = pending.back().kind;
+    pending.pop_back();
+
+    NodePtr right = std::move(operands.back());
+    operands.pop_back();
+    NodePtr left = std::move(operands.back());
+
+    NodePtr node = ( op == TokenKind::Caret ) ? makePower(std::move(left), std::move(right))
+                                              : makeNode<BinaryNode>(opChar(op), std::move(left), std::move(right));
+
+    // Operands are folded already, so a constant node here has only ConstNode children
+    operands.back() = foldConstant(std::move(node));
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+// src/poly.cpp
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "poly.hpp"
+#include "ast.hpp"
+#include "arena.hpp"
+
+
+
+namespace {
+
+// A subtree read as a polynomial in arg; a subtree that is not polynomial
+// is the polynomial u in itself
+struct PolyInfo {
+    NodePtr arg;                    // nullptr for a constant
+    std::vector<Complex> coeffs;    // Lowest degree first, no zero leading coefficient past the first
+    size_t operations = 0;          // Arithmetic nodes of the subtree
+    size_t multiplies = 0;          // Complex multiplications and divisions they cost
+
+    size_t degree() const { return coeffs.size() - 1; }
+};
+
+// Squarings and multiplications of powInt() for u^n
+size_t powIntCost(std::uint32_t n) {
+    size_t cost = 0;
+    for ( std::uint32_t k = n; k > 1; k >>= 1 ) {
+        cost += 1 + ( k & 1u );
+    }
+    return cost;
+}
+
+void trim(std::vector<Complex> &c) {
+    while ( c.size() > 1 && c.back() == 0.0L ) {
+        c.pop_back();
+    }
+}
+
+// At most one nonzero coefficient: products and powers of such polynomials
+// are again one term, so collecting them expands no sum
+bool monomial(const std::vector<Complex> &c) {
+    return std::count_if(c.begin(), c.end(), [](const Complex &v) { return v != 0.0L; }) <= 1;
+}
+
+std::vector<Complex> multiply(const std::vector<Complex> &a, const std::vector<Complex> &b) {
+    std::vector<Complex> c(a.size() + b.size() - 1, Complex(0.0));
+    for ( size_t i = 0; i < a.size(); ++i ) {
+        for ( size_t j = 0; j < b.size(); ++j ) {
+            c[i + j] += a[i] * b[j];
+        }
+    }
+    trim(c);
+    return c;
+}
+
+
+class Collector {
+public:
+    NodePtr run(const NodePtr &tree);
+
+private:
+    std::unordered_map<const Node *, PolyInfo> infos;
+    std::unordered_map<const Node *, NodePtr> built;     // Node -> node with polynomials collected
+
+    PolyInfo read(const NodePtr &node) const;
+    bool combine(const Node &node, PolyInfo &out) const;
+    NodePtr rebuild(const NodePtr &node) const;
+
+    // The common argument of a and b into arg, if they have one (a constant has none)
+    static bool unify(const PolyInfo &a, const PolyInfo &b, NodePtr &arg);
+
+    bool replaced(const PolyInfo &info, const Node *node) const {
+        return info.arg.get() != node && info.operations >= 2 && info.degree() >= 1
+            && info.multiplies >= info.degree();
+    }
+};
+
+// Two passes, both memoized over shared nodes: read every subtree as a
+// polynomial, then rebuild the tree with the replaced subtrees
+NodePtr Collector::run(const NodePtr &tree) {
+    postOrder(tree,
+        [&](const Node *node) { return infos.count(node) != 0; },
+        [&](const NodePtr &node) { infos.emplace(node.get(), read(node)); });
+
+    postOrder(tree,
+        [&](const Node *node) { return built.count(node) != 0; },
+        [&](const NodePtr &node) {
+            const PolyInfo &info = infos.at(node.get());
+            NodePtr result = replaced(info, node.get()) ? makeNode<PolyNode>(built.at(info.arg.get()), info.coeffs)
+                                                        : rebuild(node);
+            built.emplace(node.get(), std::move(result));
+        });
+
+    return built.at(tree.get());
+}
+
+bool Collector::unify(const PolyInfo &a, const PolyInfo &b, NodePtr &arg) {
+    if ( !a.arg || !b.arg ) {
+        arg = a.arg ? a.arg : b.arg;
+        return true;
+    }
+    if ( a.arg == b.arg ) {
+        arg = a.arg;
+        return true;
+    }
+
+    // Every occurrence of a variable is its own node
+    auto va = dynamic_cast<const VarNode *>(a.arg.get());
+    auto vb = dynamic_cast<const VarNode *>(b.arg.get());
+    if ( va && vb && va -> index == vb -> index ) {
+        arg = a.arg;
+        return true;
+    }
+    return false;
+}
+
+PolyInfo Collector::read(const NodePtr &node) const {
+    PolyInfo info;
+
+    if ( node -> constant ) {
+        info.coeffs = { node -> eval(Complex(0.0, 0.0)) };
+        return info;
+    }
+    if ( combine(*node, info) ) {
+        return info;
+    }
+
+    info.arg = node;
+    info.coeffs = { Complex(0.0), Complex(1.0) };
+    if ( auto poly = dynamic_cast<const PolyNode *>(node.get()) ) {
+        // Already collected: a polynomial in its own argument
+        info.arg = poly -> arg;
+        info.coeffs = poly -> coeffs;
+        info.operations = 1;
+        info.multiplies = poly -> degree();
+    }
+    return info;
+}
+
+// node as a polynomial of its operands' polynomials; false if it is none
+bool Collector::combine(const Node &node, PolyInfo &out) const {
+    if ( auto binary = dynamic_cast<const BinaryNode *>(&node) ) {
+        const PolyInfo &l = infos.at(binary -> left.get());
+        const PolyInfo &r = infos.at(binary -> right.get());
+        if ( !unify(l, r, out.arg) ) {
+            return false;
+        }
+        out.operations = l.operations + r.operations + 1;
+        out.multiplies = l.multiplies + r.multiplies;
+
+        switch (binary -> op) {
+            case '+':
+            case '-':
+                out.coeffs.assign(std::max(l.coeffs.size(), r.coeffs.size()), Complex(0.0));
+                for ( size_t k = 0; k < l.coeffs.size(); ++k )  out.coeffs[k] += l.coeffs[k];
+                for ( size_t k = 0; k < r.coeffs.size(); ++k ) {
+                    out.coeffs[k] += ( binary -> op == '+' ) ? r.coeffs[k] : -r.coeffs[k];
+                }
+                trim(out.coeffs);
+                return true;
+            case '*':
+                // Expanding (x-1)*(x-1)*... into coefficients loses the accuracy
+                // of the factored form near its roots, so only a constant factor
+                // or a product of monomials is taken in
+                if ( ( l.arg && r.arg && !( monomial(l.coeffs) && monomial(r.coeffs) ) )
+                  || l.degree() + r.degree() > maxPolyDegree ) {
+                    return false;
+                }
+                out.coeffs = multiply(l.coeffs, r.coeffs);
+                out.multiplies += 1;
+                return true;
+            case '/':
+                if ( r.arg || r.coeffs[0] == 0.0L ) {
+                    return false;
+                }
+                // Scaling the coefficients makes the division free, so it
+                // is no saving that could justify a replacement
+                out.coeffs = l.coeffs;
+                for ( Complex &c : out.coeffs )  c /= r.coeffs[0];
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    if ( auto power = dynamic_cast<const IntPowerNode *>(&node) ) {
+        const PolyInfo &base = infos.at(power -> base.get());
+        // As for '*', only powers of a monomial: (x - 1)^5 stays factored
+        if ( power -> n < 0 || !monomial(base.coeffs) || base.degree() * static_cast<size_t>(power -> n) > maxPolyDegree ) {
+            return false;
+        }
+
+        out.arg = base.arg;
+        out.coeffs = { Complex(1.0) };
+        for ( std::int32_t k = 0; k < power -> n; ++k ) {
+            out.coeffs = multiply(out.coeffs, base.coeffs);
+        }
+        out.operations = base.operations + 1;
+        out.multiplies = base.multiplies + powIntCost(static_cast<std::uint32_t>(power -> n));
+        return true;
+    }
+
+    return false;
+}
+
+// node over the collected forms of its operands, or node itself if none changed
+NodePtr Collector::rebuild(const NodePtr &node) const {
+    auto collected = [&](const NodePtr &operand) -> const NodePtr & { return built.at(operand.get()); };
+
+    if ( auto b = dynamic_cast<const BinaryNode *>(node.get()) ) {
+        const NodePtr &l = collected(b -> left);
+        const NodePtr &r = collected(b -> right);
+        return ( l == b -> left && r == b -> right ) ? node : makeNode<BinaryNode>(b -> op, l, r);
+    }
+    if ( auto p = dynamic_cast<const PowerNode *>(node.get()) ) {
+        const NodePtr &base = collected(p -> base);
+        const NodePtr &exp = collected(p -> exp);
+        return ( base == p -> base && exp == p -> exp ) ? node : makeNode<PowerNode>(base, exp);
+    }
+    if ( auto p = dynamic_cast<const IntPowerNode *>(node.get()) ) {
+        const NodePtr &base = collected(p -> base);
+        return ( base == p -> base ) ? node : makeNode<IntPowerNode>(base, p -> n);
+    }
+    if ( auto f = dynamic_cast<const FuncNode *>(node.get()) ) {
+        const NodePtr &arg = collected(f -> arg);
+        return ( arg == f -> arg ) ? node : makeNode<FuncNode>(f -> func, arg);
+    }
+    if ( auto p = dynamic_cast<const PolyNode *>(node.get()) ) {
+        const NodePtr &arg = collected(p -> arg);
+        return ( arg == p -> arg ) ? node : makeNode<PolyNode>(arg, p -> coeffs);
+    }
+
+    return node;
+}
+
+} // namespace
+
+
+
+NodePtr collectPolynomials(const NodePtr &tree) {
+    return Collector().run(tree);
+}
@@ -0,0 +1,183 @@
+// src/profile.cpp
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "profile.hpp"
+#include "ast.hpp"
+#include "functions.hpp"
+
+
+
+namespace {
+
+constexpr size_t slots = profile::FirstFunc + funcCount;
+
+std::atomic<std::uint64_t> counts[slots];
+std::atomic<std::uint64_t> nanos[slots];
+
+// Time taken by scopes nested in the innermost open one on this thread
+thread_local std::uint64_t childNanos = 0;
+
+const char *const nodeNames[profile::FirstFunc] = { "const", "var", "add", "sub", "mul", "div", "pow", "poly" };
+
+
+struct StatsWalker {
+    std::unordered_map<const Node *, profile::TreeStats> memo;
+
+    profile::TreeStats walk(const NodePtr &tree);
+    profile::TreeStats visit(const Node &node) const;
+};
+
+profile::TreeStats StatsWalker::walk(const NodePtr &tree) {
+    postOrder(tree,
+        [&](const Node *node) { return memo.count(node) != 0; },
+        [&](const NodePtr &node) { memo.emplace(node.get(), visit(*node)); });
+
+    return memo.at(tree.get());
+}
+
+// Stats of one node from the memoized stats of its operands
+profile::TreeStats StatsWalker::visit(const Node &node) const {
+    const NodePtr *children[2];
+    size_t count = operands(node, children);
+
+    profile::TreeStats stats;
+    stats.nodes = 1;
+    for ( size_t i = 0; i < count; ++i ) {
+        const profile::TreeStats &c = memo.at(children[i] -> get());
+        constexpr std::uint64_t most = std::numeric_limits<std::uint64_t>::max();
+        stats.nodes = ( c.nodes > most - stats.nodes ) ? most : stats.nodes + c.nodes;
+        stats.depth = std::max(stats.depth, c.depth);
+    }
+    stats.depth += 1;
+
+    return stats;
+}
+
+} // namespace
+
+
+
+namespace profile {
+
+size_t slotCount() {
+    return slots;
+}
+
+const char *slotName(size_t slot) {
+    if ( slot < FirstFunc ) {
+        return nodeNames[slot];
+    }
+    return funcInfo(static_cast<FuncId>(slot - FirstFunc)).name;
+}
+
+size_t binarySlot(char op) {
+    switch (op) {
+        case '+': return Add;
+        case '-': return Sub;
+        case '*': return Mul;
+        default:  return Div;
+    }
+}
+
+size_t funcSlot(FuncId id) {
+    return FirstFunc + static_cast<size_t>(id);
+}
+
+size_t opSlot(OpCode op, std::uint32_t b) {
+    switch (op) {
+        case OpCode::Const: return Const;
+        case OpCode::Var:   return Var;
+        case OpCode::Add:   return Add;
+        case OpCode::Sub:   return Sub;
+        case OpCode::Mul:   return Mul;
+        case OpCode::Div:   return Div;
+        case OpCode::Pow:   return Pow;
+        case OpCode::PowInt: return Pow;
+        case OpCode::Poly:  return Poly;
+        case OpCode::Call:  return funcSlot(static_cast<FuncId>(b));
+    }
+    return Const;
+}
+
+bool enabled() {
+#ifdef DIFF_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::vector<Entry> snapshot() {
+    std::vector<Entry> entries;
+    for ( size_t slot = 0; slot < slots; ++slot ) {
+        std::uint64_t count = counts[slot].load(std::memory_order_relaxed);
+        if ( count ) {
+            entries.push_back({ slotName(slot), count, nanos[slot].load(std::memory_order_relaxed) * 1e-9 });
+        }
+    }
+
+    return entries;
+}
+
+void reset() {
+    for ( size_t slot = 0; slot < slots; ++slot ) {
+        counts[slot].store(0, std::memory_order_relaxed);
+        nanos[slot].store(0, std::memory_order_relaxed);
+    }
+}
+
+void report(std::ostream &out) {
+    std::vector<Entry> entries = snapshot();
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.seconds > b.seconds; });
+
+    double total = 0.0;
+    for ( const Entry &entry : entries ) {
+        total += entry.seconds;
+    }
+
+    out << std::left << std::setw(8) << "node" << std::right << std::setw(14) << "evals"
+        << std::setw(14) << "self us" << std::setw(10) << "ns/eval" << std::setw(8) << "%" << "\n";
+    for ( const Entry &entry : entries ) {
+        out << std::left << std::setw(8) << entry.name << std::right << std::setw(14) << entry.count
+            << std::setw(14) << std::fixed << std::setprecision(1) << entry.seconds * 1e6
+            << std::setw(10) << entry.seconds * 1e9 / entry.count
+            << std::setw(8) << ( total > 0 ? 100.0 * entry.seconds / total : 0.0 ) << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+void record(size_t slot, std::uint64_t ns) {
+    counts[slot].fetch_add(1, std::memory_order_relaxed);
+    nanos[slot].fetch_add(ns, std::memory_order_relaxed);
+}
+
+
+Scope::Scope(size_t s) : slot(s), savedChildren(childNanos), start(std::chrono::steady_clock::now()) {
+    childNanos = 0;
+}
+
+Scope::~Scope() {
+    auto elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    record(slot, elapsed > childNanos ? elapsed - childNanos : 0);
+    childNanos = savedChildren + elapsed;
+}
+
+
+TreeStats treeStats(const NodePtr &tree) {
+    StatsWalker walker;
+    TreeStats stats = walker.walk(tree);
+    stats.uniqueNodes = walker.memo.size();
+
+    return stats;
+}
+
+} // namespace profile
@@ -0,0 +1,223 @@
+// src/series.cpp
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+#include "series.hpp"
+
+
+
+namespace series {
+
+void mul(const Complex *a, const Complex *b, Complex *d, size_t n) {
+    for ( size_t k = 0; k < n; ++k ) {
+        Complex sum(0.0);
+        for ( size_t j = 0; j <= k; ++j ) {
+            sum += a[j] * b[k - j];
+        }
+        d[k] = sum;
+    }
+}
+
+// From a = d b:  d_k = (a_k - sum_{j<k} d_j b_{k-j}) / b_0
+void div(const Complex *a, const Complex *b, Complex *d, size_t n) {
+    for ( size_t k = 0; k < n; ++k ) {
+        Complex sum = a[k];
+        for ( size_t j = 0; j < k; ++j ) {
+            sum -= d[j] * b[k - j];
+        }
+        d[k] = sum / b[0];
+    }
+}
+
+void pow(const Complex *a, const Complex *b, Complex *d, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    bool constantExponent = true;
+    for ( size_t k = 1; k < n; ++k ) {
+        constantExponent = constantExponent && b[k] == Complex(0.0);
+    }
+
+    if ( constantExponent ) {
+        // d = a^c:  a d' = c a' d  gives  d_k = sum_{j=1..k} (c j - (k - j)) a_j d_{k-j} / (k a_0)
+        const Complex c = b[0];
+        d[0] = std::pow(a[0], c);
+        for ( size_t k = 1; k < n; ++k ) {
+            Complex sum(0.0);
+            for ( size_t j = 1; j <= k; ++j ) {
+                sum += (c * Complex(j) - Complex(k - j)) * a[j] * d[k - j];
+            }
+            d[k] = sum / (Complex(k) * a[0]);
+        }
+        return;
+    }
+
+    // d = exp(b log a), anchored at std::pow so d[0] matches Node::eval
+    std::vector<Complex> l(n), w(n);
+    log(a, l.data(), n);
+    mul(b, l.data(), w.data(), n);
+    d[0] = std::pow(a[0], b[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex sum(0.0);
+        for ( size_t j = 1; j <= k; ++j ) {
+            sum += Complex(j) * w[j] * d[k - j];
+        }
+        d[k] = sum / Complex(k);
+    }
+}
+
+// The power recurrence divides by a_0; for a_0 = 0 and p >= 0 the series
+// is built by repeated squaring of series instead
+void powInt(const Complex *a, std::int32_t p, Complex *d, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    if ( a[0] != Complex(0.0) || p < 0 ) {
+        const Complex c(static_cast<long double>(p));
+        d[0] = ::powInt(a[0], p);
+        for ( size_t k = 1; k < n; ++k ) {
+            Complex sum(0.0);
+            for ( size_t j = 1; j <= k; ++j ) {
+                sum += (c * Complex(j) - Complex(k - j)) * a[j] * d[k - j];
+            }
+            d[k] = sum / (Complex(k) * a[0]);
+        }
+        return;
+    }
+
+    std::vector<Complex> power(a, a + n), product(n);
+    std::fill(d, d + n, Complex(0.0));
+    d[0] = Complex(1.0);
+    for ( std::uint32_t k = static_cast<std::uint32_t>(p); k; k >>= 1 ) {
+        if ( k & 1u ) {
+            mul(d, power.data(), product.data(), n);
+            std::copy(product.begin(), product.end(), d);
+        }
+        if ( k > 1 ) {
+            mul(power.data(), power.data(), product.data(), n);
+            power.swap(product);
+        }
+    }
+}
+
+// d' = a' d:  d_k = sum_{j=1..k} j a_j d_{k-j} / k
+void exp(const Complex *a, Complex *d, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    d[0] = std::exp(a[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex sum(0.0);
+        for ( size_t j = 1; j <= k; ++j ) {
+            sum += Complex(j) * a[j] * d[k - j];
+        }
+        d[k] = sum / Complex(k);
+    }
+}
+
+// a d' = a':  d_k = (a_k - sum_{j=1..k-1} j d_j a_{k-j} / k) / a_0
+void log(const Complex *a, Complex *d, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    d[0] = std::log(a[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex sum(0.0);
+        for ( size_t j = 1; j < k; ++j ) {
+            sum += Complex(j) * d[j] * a[k - j];
+        }
+        d[k] = (a[k] - sum / Complex(k)) / a[0];
+    }
+}
+
+// d^2 = a:  d_k = (a_k - sum_{j=1..k-1} d_j d_{k-j}) / (2 d_0)
+void sqrt(const Complex *a, Complex *d, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    d[0] = std::sqrt(a[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex sum = a[k];
+        for ( size_t j = 1; j < k; ++j ) {
+            sum -= d[j] * d[k - j];
+        }
+        d[k] = sum / (Complex(2.0) * d[0]);
+    }
+}
+
+// s' = c a',  c' = -s a'
+void sinCos(const Complex *a, Complex *s, Complex *c, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    s[0] = std::sin(a[0]);
+    c[0] = std::cos(a[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex ss(0.0), cs(0.0);
+        for ( size_t j = 1; j <= k; ++j ) {
+            ss += Complex(j) * a[j] * c[k - j];
+            cs += Complex(j) * a[j] * s[k - j];
+        }
+        s[k] = ss / Complex(k);
+        c[k] = -cs / Complex(k);
+    }
+}
+
+// s' = c a',  c' = s a'
+void sinhCosh(const Complex *a, Complex *s, Complex *c, size_t n) {
+    if ( n == 0 ) {
+        return;
+    }
+
+    s[0] = std::sinh(a[0]);
+    c[0] = std::cosh(a[0]);
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex ss(0.0), cs(0.0);
+        for ( size_t j = 1; j <= k; ++j ) {
+            ss += Complex(j) * a[j] * c[k - j];
+            cs += Complex(j) * a[j] * s[k - j];
+        }
+        s[k] = ss / Complex(k);
+        c[k] = cs / Complex(k);
+    }
+}
+
+// w = alpha + beta t^2 is extended one coefficient behind t
+void riccati(const Complex *a, Complex *t, long double alpha, long double beta, size_t n) {
+    std::vector<Complex> w(n);
+
+    for ( size_t k = 0; k < n; ++k ) {
+        if ( k > 0 ) {
+            Complex sum(0.0);
+            for ( size_t j = 1; j <= k; ++j ) {
+                sum += Complex(j) * a[j] * w[k - j];
+            }
+            t[k] = sum / Complex(k);
+        }
+
+        Complex square(0.0);
+        for ( size_t j = 0; j <= k; ++j ) {
+            square += t[j] * t[k - j];
+        }
+        w[k] = Complex(beta) * square + ( k == 0 ? Complex(alpha) : Complex(0.0) );
+    }
+}
+
+void integrate(const Complex *a, const Complex *h, Complex *g, size_t n) {
+    for ( size_t k = 1; k < n; ++k ) {
+        Complex sum(0.0);
+        for ( size_t j = 1; j <= k; ++j ) {
+            sum += Complex(j) * a[j] * h[k - j];
+        }
+        g[k] = sum / Complex(k);
+    }
+}
+
+} // namespace series
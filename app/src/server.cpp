@@ -0,0 +1,490 @@
+// src/server.cpp
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "stream.hpp"
+#include "expression.hpp"
+
+
+
+namespace {
+
+const size_t readBytes = 1 << 16;
+
+
+[[noreturn]] void fail(const std::string &what, const std::string &path) {
+    throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Remove a socket left at path; any other kind of file is left alone
+void unlinkSocket(const std::string &path) {
+    struct stat info;
+    if ( ::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode) ) {
+        ::unlink(path.c_str());
+    }
+}
+
+bool setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// The p-th percentile of sorted samples, 0 if there are none
+double percentile(const std::vector<double> &sorted, double p) {
+    if ( sorted.empty() ) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+} // namespace
+
+
+
+Server::Connection::~Connection() {
+    ::close(fd);
+}
+
+Server::WakePipe::~WakePipe() {
+    for ( int fd : { readEnd, writeEnd } ) {
+        if ( fd >= 0 )  ::close(fd);
+    }
+}
+
+void Server::WakePipe::wake() const {
+    char byte = 0;
+    ssize_t written = ::write(writeEnd, &byte, 1);
+    (void)written;
+}
+
+Server::Server(const std::string &socketPath, ExpressionCache &c, ThreadPool &p) : path(socketPath), cache(c), pool(p) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if ( path.empty() || path.size() >= sizeof(address.sun_path) ) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int pipeEnds[2];
+    if ( ::pipe(pipeEnds) != 0 ) {
+        fail("Cannot create wake pipe for", path);
+    }
+    wakePipe = std::make_shared<WakePipe>();
+    wakePipe -> readEnd = pipeEnds[0];
+    wakePipe -> writeEnd = pipeEnds[1];
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( listener < 0 ) {
+        fail("Cannot create socket", path);
+    }
+    unlinkSocket(path);
+    if ( ::bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0 ) {
+        fail("Cannot listen on", path);
+    }
+    if ( !setNonBlocking(listener) || !setNonBlocking(wakePipe -> readEnd) || !setNonBlocking(wakePipe -> writeEnd) ) {
+        fail("Cannot set non-blocking mode for", path);
+    }
+}
+
+// Only reached without workers left running: run() waits for them, and
+// this wait covers a run() that threw. A worker's last use of the Server
+// is its --inFlight; the wake-up after it goes through its own wakePipe
+Server::~Server() {
+    while ( inFlight.load() > 0 ) {
+        std::this_thread::yield();
+    }
+
+    connections.clear();
+    if ( listener >= 0 ) {
+        ::close(listener);
+        unlinkSocket(path);
+    }
+}
+
+void Server::stop() {
+    stopping.store(true);
+    wakePipe -> wake();
+}
+
+
+
+void Server::run() {
+    std::vector<pollfd> fds;
+
+    while ( !stopping.load() || inFlight.load() > 0 ) {
+        bool accepting = !stopping.load();
+
+        fds.clear();
+        fds.push_back({ wakePipe -> readEnd, POLLIN, 0 });
+        fds.push_back({ accepting ? listener : -1, POLLIN, 0 });
+        for ( const auto &conn : connections ) {
+            short events = ( accepting && !conn -> closing && !backlogged(*conn) ) ? POLLIN : 0;
+            if ( !conn -> output.empty() )  events |= POLLOUT;
+            // Not polled while idle, so a peer that hung up cannot make poll() spin
+            fds.push_back({ events ? conn -> fd : -1, events, 0 });
+        }
+
+        if ( ::poll(fds.data(), fds.size(), -1) < 0 ) {
+            if ( errno == EINTR )  continue;
+            fail("Cannot poll", path);
+        }
+
+        if ( fds[0].revents & POLLIN ) {
+            char drain[256];
+            while ( ::read(wakePipe -> readEnd, drain, sizeof(drain)) > 0 ) {}
+        }
+        if ( fds[1].revents & POLLIN ) {
+            accept();
+        }
+
+        // New connections are behind the polled ones and have no events yet
+        for ( size_t i = 0; i + 2 < fds.size(); ++i ) {
+            Connection &conn = *connections[i];
+            short events = fds[i + 2].revents;
+
+            if ( events & ( POLLIN | POLLHUP | POLLERR ) ) {
+                read(conn);
+            }
+        }
+
+        dispatch();
+
+        // Ready replies, in line order, into the output of each connection
+        for ( const auto &conn : connections ) {
+            while ( !conn -> replies.empty() && conn -> replies.front() -> ready.load(std::memory_order_acquire) ) {
+                conn -> output += conn -> replies.front() -> text;
+                conn -> pendingPoints -= conn -> replies.front() -> points;
+                conn -> replies.pop_front();
+            }
+            if ( !conn -> output.empty() && !conn -> failed ) {
+                write(*conn);
+            }
+        }
+
+        auto finished = [](const std::unique_ptr<Connection> &conn) {
+            return conn -> failed || ( conn -> closing && conn -> replies.empty() && conn -> output.empty() );
+        };
+        connections.erase(std::remove_if(connections.begin(), connections.end(), finished), connections.end());
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        counters.open = connections.size();
+    }
+
+    connections.clear();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    counters.open = 0;
+    counters.queued = 0;
+    pending.clear();
+    filling.clear();
+}
+
+void Server::accept() {
+    while ( true ) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if ( fd < 0 ) {
+            return;     // EAGAIN: no more waiting; anything else: retried by the next poll
+        }
+        if ( !setNonBlocking(fd) ) {
+            ::close(fd);
+            continue;
+        }
+
+        connections.push_back(std::make_unique<Connection>(fd));
+        std::lock_guard<std::mutex> lock(statsMutex);
+        ++counters.connections;
+    }
+}
+
+void Server::read(Connection &conn) {
+    char buffer[readBytes];
+
+    while ( !conn.closing && !backlogged(conn) ) {
+        ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+        if ( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+            break;
+        }
+        if ( n < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( n < 0 ) {
+            conn.failed = true;
+            return;
+        }
+        if ( n == 0 ) {
+            // A last line without newline still counts, as with std::getline
+            conn.closing = true;
+            if ( !conn.input.empty() ) {
+                handleLine(conn, std::move(conn.input));
+                conn.input.clear();
+            }
+            return;
+        }
+
+        conn.input.append(buffer, static_cast<size_t>(n));
+
+        size_t start = 0;
+        for ( size_t end; ( end = conn.input.find('\n', start) ) != std::string::npos; start = end + 1 ) {
+            handleLine(conn, conn.input.substr(start, end - start));
+        }
+        conn.input.erase(0, start);
+
+        if ( conn.input.size() > maxLineBytes ) {
+            std::string text;
+            appendError(text, conn.lines + 1, "line longer than " + std::to_string(maxLineBytes) + " bytes");
+            answer(conn, std::move(text), 1);
+            conn.input.clear();
+            conn.closing = true;
+        }
+    }
+}
+
+bool Server::backlogged(const Connection &conn) {
+    return conn.output.size() >= maxOutputBytes || conn.replies.size() >= maxPendingReplies
+        || conn.pendingPoints >= maxPendingPoints;
+}
+
+void Server::write(Connection &conn) {
+    size_t sent = 0;
+
+    while ( sent < conn.output.size() ) {
+        ssize_t n = ::send(conn.fd, conn.output.data() + sent, conn.output.size() - sent, MSG_NOSIGNAL);
+        if ( n < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( n < 0 ) {
+            conn.failed = ( errno != EAGAIN && errno != EWOULDBLOCK );
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    conn.output.erase(0, sent);
+}
+
+
+
+void Server::answer(Connection &conn, std::string text, size_t errors) {
+    auto reply = std::make_shared<Reply>();
+    reply -> text = std::move(text);
+    reply -> ready.store(true, std::memory_order_release);
+    conn.replies.push_back(std::move(reply));
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    counters.errors += errors;
+}
+
+void Server::handleLine(Connection &conn, std::string line) {
+    size_t lineNumber = ++conn.lines;
+
+    if ( !line.empty() && line.back() == '\r' ) {
+        line.pop_back();
+    }
+    size_t start = line.find_first_not_of(" \t");
+
+    if ( start == std::string::npos || line[start] == '#' ) {
+        return;
+    }
+    if ( line[start] == '@' ) {
+        conn.expression = ExpressionCache::normalize(line.substr(start + 1));
+        return;
+    }
+    if ( line[start] == '?' ) {
+        answer(conn, formatStats(stats()), 0);
+        return;
+    }
+    if ( conn.expression.empty() ) {
+        std::string text;
+        appendError(text, lineNumber, "no valid expression before points");
+        answer(conn, std::move(text), 1);
+        return;
+    }
+
+    Request request;
+    request.line = lineNumber;
+    request.received = Clock::now();
+
+    size_t pos = start;
+    while ( pos < line.size() ) {
+        size_t end = std::min(line.find_first_of(" \t", pos), line.size());
+        std::string token = line.substr(pos, end - pos);
+        pos = std::min(line.find_first_not_of(" \t", end), line.size());
+
+        Complex z;
+        if ( parsePoint(token, z) ) {
+            request.points.push_back(z);
+        }
+        else {
+            request.invalid.emplace_back(request.points.size(), std::move(token));
+        }
+    }
+
+    // Nothing to evaluate: the errors are the whole reply
+    if ( request.points.empty() ) {
+        std::string text;
+        for ( const auto &invalid : request.invalid ) {
+            appendError(text, lineNumber, "invalid point '" + invalid.second + "'");
+        }
+        answer(conn, std::move(text), request.invalid.size());
+        return;
+    }
+
+    enqueue(conn, std::move(request));
+}
+
+void Server::enqueue(Connection &conn, Request request) {
+    request.reply = std::make_shared<Reply>();
+    request.reply -> points = request.points.size();
+    conn.replies.push_back(request.reply);
+    conn.pendingPoints += request.points.size();
+
+    // std::deque keeps references to its elements across push_back and pop_front
+    Batch *&batch = filling[conn.expression];
+    if ( !batch || batch -> points >= maxBatchPoints ) {
+        pending.push_back({ conn.expression, {}, 0 });
+        batch = &pending.back();
+    }
+    batch -> points += request.points.size();
+    batch -> requests.push_back(std::move(request));
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++counters.queued;
+}
+
+// Oldest batches first, one per free worker; the rest keep filling
+void Server::dispatch() {
+    while ( !pending.empty() && inFlight.load() < pool.size() ) {
+        auto found = filling.find(pending.front().key);
+        if ( found != filling.end() && found -> second == &pending.front() ) {
+            filling.erase(found);
+        }
+
+        auto batch = std::make_shared<Batch>(std::move(pending.front()));
+        pending.pop_front();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            counters.queued -= batch -> requests.size();
+        }
+
+        ++inFlight;
+        pool.submit([this, batch, pipe = wakePipe] {
+            evaluate(*batch);
+            --inFlight;     // run() may return and the Server go after this
+            pipe -> wake();
+        });
+    }
+}
+
+// On a worker: all points of the batch in one evalBatch() per order
+void Server::evaluate(Batch &batch) {
+    std::vector<Complex> in;
+    in.reserve(batch.points);
+    for ( const Request &request : batch.requests ) {
+        in.insert(in.end(), request.points.begin(), request.points.end());
+    }
+
+    std::vector<Complex> out[3];
+    std::string error;
+    try {
+        std::shared_ptr<const Expression> expr = cache.get(batch.key);
+        for ( int order = 0; order < 3; ++order ) {
+            out[order].resize(in.size());
+            expr -> evalBatch(order, in.data(), out[order].data(), in.size());
+        }
+    }
+    catch (const std::runtime_error &e) {
+        error = e.what();
+    }
+
+    size_t errors = 0;
+    size_t offset = 0;
+    std::vector<double> samples;
+    samples.reserve(batch.requests.size());
+
+    for ( Request &request : batch.requests ) {
+        std::string text;
+
+        if ( !error.empty() ) {
+            appendError(text, request.line, error);
+            ++errors;
+        }
+        else {
+            size_t invalid = 0;
+            for ( size_t i = 0; i <= request.points.size(); ++i ) {
+                for ( ; invalid < request.invalid.size() && request.invalid[invalid].first == i; ++invalid ) {
+                    appendError(text, request.line, "invalid point '" + request.invalid[invalid].second + "'");
+                    ++errors;
+                }
+                if ( i < request.points.size() ) {
+                    size_t k = offset + i;
+                    appendRecord(text, request.points[i], { out[0][k], out[1][k], out[2][k] });
+                }
+            }
+        }
+        offset += request.points.size();
+
+        request.reply -> text = std::move(text);
+        request.reply -> ready.store(true, std::memory_order_release);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - request.received).count());
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++counters.batches;
+    counters.requests += batch.requests.size();
+    counters.points += error.empty() ? in.size() : 0;
+    counters.errors += errors;
+
+    for ( double sample : samples ) {
+        if ( latencies.size() < latencyWindow ) {
+            latencies.push_back(sample);
+        }
+        else {
+            latencies[latencyNext] = sample;
+        }
+        latencyNext = ( latencyNext + 1 ) % latencyWindow;
+    }
+}
+
+ServerStats Server::stats() const {
+    std::vector<double> sorted;
+    ServerStats stats;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats = counters;
+        sorted = latencies;
+    }
+    stats.inFlight = inFlight.load();
+
+    std::sort(sorted.begin(), sorted.end());
+    stats.p50 = percentile(sorted, 0.50);
+    stats.p90 = percentile(sorted, 0.90);
+    stats.p99 = percentile(sorted, 0.99);
+    stats.max = sorted.empty() ? 0.0 : sorted.back();
+
+    return stats;
+}
+
+std::string formatStats(const ServerStats &stats) {
+    char buffer[512];
+    int n = std::snprintf(buffer, sizeof(buffer),
+        "stats connections=%zu open=%zu requests=%zu points=%zu errors=%zu batches=%zu queued=%zu in_flight=%zu "
+        "p50_us=%.1f p90_us=%.1f p99_us=%.1f max_us=%.1f\n",
+        stats.connections, stats.open, stats.requests, stats.points, stats.errors, stats.batches,
+        stats.queued, stats.inFlight, stats.p50, stats.p90, stats.p99, stats.max);
+
+    return std::string(buffer, static_cast<size_t>(n));
+}
@@ -0,0 +1,289 @@
+// src/simd.cpp
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "simd.hpp"
+#include "ast.hpp"
+
+
+
+namespace {
+
+// Thin wrappers over one vector register of doubles, so the kernels below
+// are written once for every instruction set
+#if defined(__AVX512F__)
+
+#define SIMD_HAVE_VEC 1
+
+struct Vec {
+    using Reg = __m512d;
+    using Mask = __mmask8;
+    static constexpr size_t width = 8;
+    static constexpr const char *name = "avx512";
+
+    static Reg load(const double *p) { return _mm512_loadu_pd(p); }
+    static Reg broadcast(double v) { return _mm512_set1_pd(v); }
+    static void store(double *p, Reg v) { _mm512_storeu_pd(p, v); }
+    static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+    static Reg div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+    static Reg abs(Reg a) { return _mm512_abs_pd(a); }
+    static Mask greaterEqual(Reg a, Reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+    static Reg select(Mask m, Reg ifTrue, Reg ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+};
+
+#elif defined(__AVX2__)
+
+#define SIMD_HAVE_VEC 1
+
+struct Vec {
+    using Reg = __m256d;
+    using Mask = __m256d;
+    static constexpr size_t width = 4;
+    static constexpr const char *name = "avx2";
+
+    static Reg load(const double *p) { return _mm256_loadu_pd(p); }
+    static Reg broadcast(double v) { return _mm256_set1_pd(v); }
+    static void store(double *p, Reg v) { _mm256_storeu_pd(p, v); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    static Reg div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+    static Reg abs(Reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static Mask greaterEqual(Reg a, Reg b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static Reg select(Mask m, Reg ifTrue, Reg ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+};
+
+#endif
+
+
+// Smith's algorithm: scale by the larger component of b to avoid overflow
+inline void divScalar(double ar, double ai, double br, double bi, double &dr, double &di) {
+    if ( std::fabs(br) >= std::fabs(bi) ) {
+        double r = bi / br;
+        double den = br + bi * r;
+        dr = (ar + ai * r) / den;
+        di = (ai - ar * r) / den;
+    }
+    else {
+        double r = br / bi;
+        double den = bi + br * r;
+        dr = (ar * r + ai) / den;
+        di = (ai * r - ar) / den;
+    }
+}
+
+// tan(a + ib) = (sin 2a + i sinh 2b) / (cos 2a + cosh 2b); for large |b|
+// the quotient tends to 2 sin(2a) e^(-2|b|) + i sign(b), computed directly
+inline void tanScalar(double a, double b, double &dr, double &di) {
+    if ( std::fabs(b) > 20.0 ) {
+        dr = 2.0 * std::sin(2.0 * a) * std::exp(-2.0 * std::fabs(b));
+        di = std::copysign(1.0, b);
+        return;
+    }
+
+    double den = std::cos(2.0 * a) + std::cosh(2.0 * b);
+    dr = std::sin(2.0 * a) / den;
+    di = std::sinh(2.0 * b) / den;
+}
+
+} // namespace
+
+
+
+namespace simd {
+
+void add(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n) {
+    size_t j = 0;
+#ifdef SIMD_HAVE_VEC
+    for ( ; j + Vec::width <= n; j += Vec::width ) {
+        Vec::store(dr + j, Vec::add(Vec::load(ar + j), Vec::load(br + j)));
+        Vec::store(di + j, Vec::add(Vec::load(ai + j), Vec::load(bi + j)));
+    }
+#endif
+    for ( ; j < n; ++j ) {
+        dr[j] = ar[j] + br[j];
+        di[j] = ai[j] + bi[j];
+    }
+}
+
+void sub(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n) {
+    size_t j = 0;
+#ifdef SIMD_HAVE_VEC
+    for ( ; j + Vec::width <= n; j += Vec::width ) {
+        Vec::store(dr + j, Vec::sub(Vec::load(ar + j), Vec::load(br + j)));
+        Vec::store(di + j, Vec::sub(Vec::load(ai + j), Vec::load(bi + j)));
+    }
+#endif
+    for ( ; j < n; ++j ) {
+        dr[j] = ar[j] - br[j];
+        di[j] = ai[j] - bi[j];
+    }
+}
+
+// (ar + i ai)(br + i bi) = (ar br - ai bi) + i (ar bi + ai br)
+void mul(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n) {
+    size_t j = 0;
+#ifdef SIMD_HAVE_VEC
+    for ( ; j + Vec::width <= n; j += Vec::width ) {
+        Vec::Reg xr = Vec::load(ar + j), xi = Vec::load(ai + j);
+        Vec::Reg yr = Vec::load(br + j), yi = Vec::load(bi + j);
+        Vec::store(dr + j, Vec::sub(Vec::mul(xr, yr), Vec::mul(xi, yi)));
+        Vec::store(di + j, Vec::add(Vec::mul(xr, yi), Vec::mul(xi, yr)));
+    }
+#endif
+    for ( ; j < n; ++j ) {
+        double xr = ar[j], xi = ai[j], yr = br[j], yi = bi[j];
+        dr[j] = xr * yr - xi * yi;
+        di[j] = xr * yi + xi * yr;
+    }
+}
+
+// Smith's division, both branches computed and blended per lane
+void div(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n) {
+    size_t j = 0;
+#ifdef SIMD_HAVE_VEC
+    for ( ; j + Vec::width <= n; j += Vec::width ) {
+        Vec::Reg xr = Vec::load(ar + j), xi = Vec::load(ai + j);
+        Vec::Reg yr = Vec::load(br + j), yi = Vec::load(bi + j);
+        Vec::Mask realLarger = Vec::greaterEqual(Vec::abs(yr), Vec::abs(yi));
+
+        // |yr| >= |yi|: r = yi/yr, den = yr + yi r
+        Vec::Reg r1 = Vec::div(yi, yr);
+        Vec::Reg den1 = Vec::add(yr, Vec::mul(yi, r1));
+        Vec::Reg re1 = Vec::div(Vec::add(xr, Vec::mul(xi, r1)), den1);
+        Vec::Reg im1 = Vec::div(Vec::sub(xi, Vec::mul(xr, r1)), den1);
+
+        // |yr| < |yi|: r = yr/yi, den = yi + yr r
+        Vec::Reg r2 = Vec::div(yr, yi);
+        Vec::Reg den2 = Vec::add(yi, Vec::mul(yr, r2));
+        Vec::Reg re2 = Vec::div(Vec::add(Vec::mul(xr, r2), xi), den2);
+        Vec::Reg im2 = Vec::div(Vec::sub(Vec::mul(xi, r2), xr), den2);
+
+        Vec::store(dr + j, Vec::select(realLarger, re1, re2));
+        Vec::store(di + j, Vec::select(realLarger, im1, im2));
+    }
+#endif
+    for ( ; j < n; ++j ) {
+        divScalar(ar[j], ai[j], br[j], bi[j], dr[j], di[j]);
+    }
+}
+
+// a^b = exp(b log a), with 0^b = 0
+void pow(const double *ar, const double *ai, const double *br, const double *bi, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        double xr = ar[j], xi = ai[j], yr = br[j], yi = bi[j];
+        if ( xr == 0.0 && xi == 0.0 ) {
+            dr[j] = 0.0;
+            di[j] = 0.0;
+            continue;
+        }
+
+        double lr = std::log(std::hypot(xr, xi));
+        double li = std::atan2(xi, xr);
+        double wr = yr * lr - yi * li;
+        double wi = yr * li + yi * lr;
+        double m = std::exp(wr);
+        dr[j] = m * std::cos(wi);
+        di[j] = m * std::sin(wi);
+    }
+}
+
+void powInt(const double *ar, const double *ai, std::int32_t p, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        std::complex<double> r = ::powInt(std::complex<double>(ar[j], ai[j]), p);
+        dr[j] = r.real();
+        di[j] = r.imag();
+    }
+}
+
+// sin(a + ib) = sin a cosh b + i cos a sinh b
+void sin(const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        double a = ar[j], b = ai[j];
+        dr[j] = std::sin(a) * std::cosh(b);
+        di[j] = std::cos(a) * std::sinh(b);
+    }
+}
+
+// cos(a + ib) = cos a cosh b - i sin a sinh b
+void cos(const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        double a = ar[j], b = ai[j];
+        dr[j] = std::cos(a) * std::cosh(b);
+        di[j] = -std::sin(a) * std::sinh(b);
+    }
+}
+
+void tan(const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        tanScalar(ar[j], ai[j], dr[j], di[j]);
+    }
+}
+
+// cot(z) = 1 / tan(z), as evaluated by the tree
+void cot(const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        double tr, ti;
+        tanScalar(ar[j], ai[j], tr, ti);
+        divScalar(1.0, 0.0, tr, ti, dr[j], di[j]);
+    }
+}
+
+// log(a + ib) = log|z| + i arg(z)
+void log(const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    for ( size_t j = 0; j < n; ++j ) {
+        double a = ar[j], b = ai[j];
+        dr[j] = std::log(std::hypot(a, b));
+        di[j] = std::atan2(b, a);
+    }
+}
+
+// r = r a + c[k] from the top coefficient down: each lane runs its own
+// chain, so the chains of a vector's lanes overlap
+void horner(const double *cr, const double *ci, size_t degree, const double *ar, const double *ai, double *dr, double *di, size_t n) {
+    size_t j = 0;
+#ifdef SIMD_HAVE_VEC
+    for ( ; j + Vec::width <= n; j += Vec::width ) {
+        Vec::Reg xr = Vec::load(ar + j), xi = Vec::load(ai + j);
+        Vec::Reg rr = Vec::broadcast(cr[degree]), ri = Vec::broadcast(ci[degree]);
+        for ( size_t k = degree; k-- > 0; ) {
+            Vec::Reg pr = Vec::sub(Vec::mul(rr, xr), Vec::mul(ri, xi));
+            Vec::Reg pi = Vec::add(Vec::mul(rr, xi), Vec::mul(ri, xr));
+            rr = Vec::add(pr, Vec::broadcast(cr[k]));
+            ri = Vec::add(pi, Vec::broadcast(ci[k]));
+        }
+        Vec::store(dr + j, rr);
+        Vec::store(di + j, ri);
+    }
+#endif
+    for ( ; j < n; ++j ) {
+        double xr = ar[j], xi = ai[j];
+        double rr = cr[degree], ri = ci[degree];
+        for ( size_t k = degree; k-- > 0; ) {
+            double pr = rr * xr - ri * xi;
+            double pi = rr * xi + ri * xr;
+            rr = pr + cr[k];
+            ri = pi + ci[k];
+        }
+        dr[j] = rr;
+        di[j] = ri;
+    }
+}
+
+const char *isa() {
+#ifdef SIMD_HAVE_VEC
+    return Vec::name;
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace simd
@@ -0,0 +1,191 @@
+// src/simplify.cpp
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "simplify.hpp"
+#include "ast.hpp"
+#include "arena.hpp"
+
+
+
+namespace {
+
+// Returns the constant's value if node is a ConstNode
+const ConstNode *asConst(const NodePtr &node) {
+    return dynamic_cast<const ConstNode *>(node.get());
+}
+
+// Exactly the real value: a folded constant such as (0, -0) compares equal
+// to 0, but replacing it by +0 would move results across branch cuts
+bool isConst(const NodePtr &node, long double value) {
+    auto constant = asConst(node);
+    return constant && constant -> value.real() == value
+        && constant -> value.imag() == 0.0L && !std::signbit(constant -> value.imag());
+}
+
+NodePtr makeConst(long double value) {
+    return makeNode<ConstNode>(value);
+}
+
+
+class Simplifier {
+public:
+    NodePtr run(const NodePtr &node);
+
+    // The memoized result for node, or nullptr
+    const NodePtr *find(const Node *node) const {
+        auto found = done.find(node);
+        return ( found != done.end() ) ? &found -> second : nullptr;
+    }
+
+private:
+    std::unordered_map<const Node *, NodePtr> done;    // Memo, keeps shared subtrees shared
+
+    // Simplified form of an operand, already in the memo
+    const NodePtr &simplified(const NodePtr &operand) const { return done.at(operand.get()); }
+
+    NodePtr visit(const NodePtr &node);
+    NodePtr binary(const NodePtr &node, const BinaryNode &binary);
+    NodePtr power(const NodePtr &node, const PowerNode &power);
+    NodePtr intPower(const NodePtr &node, const IntPowerNode &power);
+    NodePtr func(const NodePtr &node, const FuncNode &func);
+    NodePtr poly(const NodePtr &node, const PolyNode &poly);
+};
+
+// Operands are simplified before the nodes using them, by an explicit-stack walk
+NodePtr Simplifier::run(const NodePtr &tree) {
+    postOrder(tree,
+        [&](const Node *node) { return done.count(node) != 0; },
+        [&](const NodePtr &node) { done.emplace(node.get(), visit(node)); });
+
+    return done.at(tree.get());
+}
+
+NodePtr Simplifier::visit(const NodePtr &node) {
+    NodePtr result = node;
+
+    if ( auto b = dynamic_cast<const BinaryNode *>(node.get()) ) {
+        result = binary(node, *b);
+    }
+    else if ( auto p = dynamic_cast<const PowerNode *>(node.get()) ) {
+        result = power(node, *p);
+    }
+    else if ( auto p = dynamic_cast<const IntPowerNode *>(node.get()) ) {
+        result = intPower(node, *p);
+    }
+    else if ( auto f = dynamic_cast<const FuncNode *>(node.get()) ) {
+        result = func(node, *f);
+    }
+    else if ( auto p = dynamic_cast<const PolyNode *>(node.get()) ) {
+        result = poly(node, *p);
+    }
+
+    return result;
+}
+
+NodePtr Simplifier::binary(const NodePtr &node, const BinaryNode &binary) {
+    NodePtr l = simplified(binary.left);
+    NodePtr r = simplified(binary.right);
+
+    switch (binary.op) {
+        case '+':
+            if ( isConst(l, 0.0) )  return r;
+            if ( isConst(r, 0.0) )  return l;
+            break;
+        case '-':
+            if ( isConst(r, 0.0) )  return l;
+            break;
+        case '*':
+            if ( isConst(l, 0.0) || isConst(r, 0.0) )  return makeConst(0.0);
+            if ( isConst(l, 1.0) )  return r;
+            if ( isConst(r, 1.0) )  return l;
+            break;
+        case '/':
+            if ( isConst(l, 0.0) )  return makeConst(0.0);
+            if ( isConst(r, 1.0) )  return l;
+            break;
+    }
+
+    NodePtr result = ( l == binary.left && r == binary.right ) ? node : makeNode<BinaryNode>(binary.op, l, r);
+    return foldConstant(result);
+}
+
+NodePtr Simplifier::power(const NodePtr &node, const PowerNode &power) {
+    NodePtr b = simplified(power.base);
+    NodePtr e = simplified(power.exp);
+
+    if ( !asConst(b) ) {
+        if ( isConst(e, 0.0) )  return makeConst(1.0);
+        if ( isConst(e, 1.0) )  return b;
+    }
+
+    // An exponent that became constant may now make an IntPowerNode or sqrt
+    NodePtr result = ( b == power.base && e == power.exp ) ? node : makePower(b, e);
+    return foldConstant(result);
+}
+
+NodePtr Simplifier::intPower(const NodePtr &node, const IntPowerNode &power) {
+    NodePtr b = simplified(power.base);
+
+    if ( !asConst(b) ) {
+        if ( power.n == 0 )  return makeConst(1.0);
+        if ( power.n == 1 )  return b;
+    }
+
+    NodePtr result = ( b == power.base ) ? node : makeNode<IntPowerNode>(b, power.n);
+    return foldConstant(result);
+}
+
+NodePtr Simplifier::func(const NodePtr &node, const FuncNode &func) {
+    NodePtr arg = simplified(func.arg);
+
+    NodePtr result = ( arg == func.arg ) ? node : makeNode<FuncNode>(func.func, arg);
+    return foldConstant(result);
+}
+
+NodePtr Simplifier::poly(const NodePtr &node, const PolyNode &poly) {
+    NodePtr arg = simplified(poly.arg);
+
+    NodePtr result = ( arg == poly.arg ) ? node : makeNode<PolyNode>(arg, poly.coeffs);
+    return foldConstant(result);
+}
+
+
+} // namespace
+
+
+
+NodePtr simplify(const NodePtr &tree) {
+    return Simplifier().run(tree);
+}
+
+
+struct SimplifyCache::Memo {
+    Simplifier simplifier;
+    std::vector<NodePtr> inputs;    // Keeps the keys of the simplifier's memo alive
+};
+
+SimplifyCache::SimplifyCache() : memo(std::make_unique<Memo>()) {}
+
+SimplifyCache::~SimplifyCache() = default;
+
+NodePtr SimplifyCache::simplify(const NodePtr &tree) {
+    if ( const NodePtr *known = memo -> simplifier.find(tree.get()) ) {
+        return *known;
+    }
+    memo -> inputs.push_back(tree);
+    return memo -> simplifier.run(tree);
+}
+
+size_t countNodes(const NodePtr &tree) {
+    std::unordered_set<const Node *> seen;
+    postOrder(tree,
+        [&](const Node *node) { return seen.count(node) != 0; },
+        [&](const NodePtr &node) { seen.insert(node.get()); });
+
+    return seen.size();
+}
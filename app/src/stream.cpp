@@ -0,0 +1,138 @@
+// src/stream.cpp
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "stream.hpp"
+#include "cache.hpp"
+#include "expression.hpp"
+
+
+
+namespace {
+
+const size_t flushBytes = 1 << 16;
+
+
+// Space-separated, except before the first number of a line
+void appendNumber(std::string &out, long double value, bool first) {
+    char buffer[48];
+    int n = std::snprintf(buffer, sizeof(buffer), first ? "%.21Lg" : " %.21Lg", value);
+    out.append(buffer, static_cast<size_t>(n));
+}
+
+} // namespace
+
+
+
+bool parsePoint(const std::string &token, Complex &z) {
+    const char *text = token.c_str();
+    char *end = nullptr;
+
+    errno = 0;
+    long double re = std::strtold(text, &end);
+    if ( end == text || errno == ERANGE ) {
+        return false;
+    }
+
+    long double im = 0.0;
+    if ( *end == ',' ) {
+        const char *imText = end + 1;
+        im = std::strtold(imText, &end);
+        if ( end == imText || errno == ERANGE ) {
+            return false;
+        }
+    }
+
+    z = Complex(re, im);
+    return *end == '\0';
+}
+
+void appendRecord(std::string &out, const Complex &z, const Jet &jet) {
+    const Complex values[4] = { z, jet.f, jet.f1, jet.f2 };
+
+    for ( size_t i = 0; i < 4; ++i ) {
+        appendNumber(out, values[i].real(), i == 0);
+        appendNumber(out, values[i].imag(), false);
+    }
+    out += '\n';
+}
+
+void appendError(std::string &out, size_t line, const std::string &message) {
+    out += "error " + std::to_string(line) + ": " + message + "\n";
+}
+
+StreamStats runStream(std::istream &in, std::ostream &out, ExpressionCache &cache) {
+    StreamStats stats;
+    std::shared_ptr<const Expression> current;
+    std::string line, buffer;
+
+    while ( std::getline(in, line) ) {
+        ++stats.lines;
+
+        if ( !line.empty() && line.back() == '\r' ) {
+            line.pop_back();
+        }
+        size_t start = line.find_first_not_of(" \t");
+
+        if ( start == std::string::npos || line[start] == '#' ) {
+            continue;
+        }
+
+        if ( line[start] == '@' ) {
+            ++stats.expressions;
+            try {
+                current = cache.get(line.substr(start + 1));
+            }
+            catch (const std::runtime_error &e) {
+                current = nullptr;
+                ++stats.errors;
+                appendError(buffer, stats.lines, e.what());
+            }
+        }
+        else if ( !current ) {
+            ++stats.errors;
+            appendError(buffer, stats.lines, "no valid expression before points");
+        }
+        else {
+            size_t pos = start;
+            while ( pos < line.size() ) {
+                size_t end = line.find_first_of(" \t", pos);
+                if ( end == std::string::npos ) {
+                    end = line.size();
+                }
+                std::string token = line.substr(pos, end - pos);
+                pos = line.find_first_not_of(" \t", end);
+                if ( pos == std::string::npos ) {
+                    pos = line.size();
+                }
+
+                Complex z;
+                if ( !parsePoint(token, z) ) {
+                    ++stats.errors;
+                    appendError(buffer, stats.lines, "invalid point '" + token + "'");
+                    continue;
+                }
+
+                ++stats.points;
+                appendRecord(buffer, z, current -> evalAll(z));
+            }
+        }
+
+        if ( buffer.size() >= flushBytes ) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+
+    return stats;
+}
@@ -0,0 +1,37 @@
+// src/symbols.cpp
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "symbols.hpp"
+
+
+
+SymbolTable::SymbolTable(const std::vector<std::string> &names) {
+    for ( const std::string &name : names ) {
+        if ( find(name) ) {
+            throw std::runtime_error("Variable declared twice: " + name);
+        }
+        declare(name);
+    }
+}
+
+std::uint32_t SymbolTable::declare(std::string_view name) {
+    if ( const std::uint32_t *index = find(name) ) {
+        return *index;
+    }
+
+    auto index = static_cast<std::uint32_t>(names.size());
+    names.emplace_back(name);
+    indices.emplace(names.back(), index);
+
+    return index;
+}
+
+// Lookups build a std::string key; the table is only consulted at parse time
+const std::uint32_t *SymbolTable::find(std::string_view name) const {
+    auto found = indices.find(std::string(name));
+    return ( found != indices.end() ) ? &found -> second : nullptr;
+}
@@ -0,0 +1,738 @@
+// src/tape.cpp
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tape.hpp"
+#include "simd.hpp"
+#include "ast.hpp"
+#include "functions.hpp"
+#include "interval.hpp"
+#include "series.hpp"
+#include "profile.hpp"
+
+
+
+namespace {
+
+// Emits one SSA instruction per unique node (instruction index == value id)
+class TapeBuilder {
+public:
+    std::vector<Instruction> code;
+    std::vector<Complex> constants;
+    std::uint32_t variables = 0;    // One more than the largest variable index seen
+
+    // Emit every node of tree not emitted yet, operands first; returns the root's value id
+    std::uint32_t emit(const NodePtr &tree);
+
+private:
+    std::unordered_map<const Node *, std::uint32_t> emitted;   // node -> value id
+
+    std::uint32_t emitNode(const Node *node);
+
+    std::uint32_t push(OpCode op, std::uint32_t a = 0, std::uint32_t b = 0);
+};
+
+std::uint32_t TapeBuilder::push(OpCode op, std::uint32_t a, std::uint32_t b) {
+    auto id = static_cast<std::uint32_t>(code.size());
+    code.push_back({ op, id, a, b });
+
+    return id;
+}
+
+std::uint32_t TapeBuilder::emit(const NodePtr &tree) {
+    postOrder(tree,
+        [&](const Node *node) { return emitted.count(node) != 0; },
+        [&](const NodePtr &node) { emitted.emplace(node.get(), emitNode(node.get())); });
+
+    return emitted.at(tree.get());
+}
+
+// One instruction for a node whose operands are already emitted
+std::uint32_t TapeBuilder::emitNode(const Node *node) {
+    std::uint32_t id;
+
+    if ( auto constant = dynamic_cast<const ConstNode *>(node) ) {
+        constants.push_back(constant -> value);
+        id = push(OpCode::Const, static_cast<std::uint32_t>(constants.size() - 1));
+    }
+    else if ( auto var = dynamic_cast<const VarNode *>(node) ) {
+        variables = std::max(variables, var -> index + 1);
+        id = push(OpCode::Var, var -> index);
+    }
+    else if ( auto binary = dynamic_cast<const BinaryNode *>(node) ) {
+        std::uint32_t a = emitted.at(binary -> left.get());
+        std::uint32_t b = emitted.at(binary -> right.get());
+
+        switch (binary -> op) {
+            case '+': id = push(OpCode::Add, a, b); break;
+            case '-': id = push(OpCode::Sub, a, b); break;
+            case '*': id = push(OpCode::Mul, a, b); break;
+            case '/': id = push(OpCode::Div, a, b); break;
+            default: throw std::runtime_error("Unknown binary op");
+        }
+    }
+    else if ( auto power = dynamic_cast<const PowerNode *>(node) ) {
+        std::uint32_t a = emitted.at(power -> base.get());
+        std::uint32_t b = emitted.at(power -> exp.get());
+        id = push(OpCode::Pow, a, b);
+    }
+    else if ( auto power = dynamic_cast<const IntPowerNode *>(node) ) {
+        std::uint32_t a = emitted.at(power -> base.get());
+        id = push(OpCode::PowInt, a, static_cast<std::uint32_t>(power -> n));
+    }
+    else if ( auto func = dynamic_cast<const FuncNode *>(node) ) {
+        std::uint32_t a = emitted.at(func -> arg.get());
+        id = push(OpCode::Call, a, static_cast<std::uint32_t>(func -> func));
+    }
+    else if ( auto poly = dynamic_cast<const PolyNode *>(node) ) {
+        // Coefficients go to the constant pool as one run
+        if ( poly -> degree() > 0xffu || constants.size() + poly -> coeffs.size() > maxPolyOffset ) {
+            throw std::runtime_error("Polynomial too large for the tape");
+        }
+        auto offset = static_cast<std::uint32_t>(constants.size());
+        constants.insert(constants.end(), poly -> coeffs.begin(), poly -> coeffs.end());
+
+        std::uint32_t a = emitted.at(poly -> arg.get());
+        id = push(OpCode::Poly, a, polyOperand(offset, static_cast<std::uint32_t>(poly -> degree())));
+    }
+    else {
+        throw std::runtime_error("Cannot compile node to tape");
+    }
+
+    return id;
+}
+
+
+// Map SSA value ids onto register slots, freeing a slot after its last read.
+// Returns the number of slots used; `results` are rewritten to their slots.
+std::uint32_t allocateRegisters(std::vector<Instruction> &code, std::vector<std::uint32_t> &results) {
+    std::vector<size_t> lastUse(code.size(), 0);
+    for ( size_t i = 0; i < code.size(); ++i ) {
+        int n = operandCount(code[i].op);
+        if ( n >= 1 )  lastUse[code[i].a] = i;
+        if ( n >= 2 )  lastUse[code[i].b] = i;
+    }
+    for ( std::uint32_t result : results ) {
+        lastUse[result] = code.size();  // Keep results alive past the end
+    }
+
+    std::vector<std::uint32_t> slot(code.size(), 0);
+    std::vector<std::uint32_t> freeSlots;
+    std::uint32_t registers = 0;
+
+    for ( size_t i = 0; i < code.size(); ++i ) {
+        Instruction &instr = code[i];
+        int n = operandCount(instr.op);
+
+        // Operands are read before dst is written, so their slots can be reused right away
+        std::uint32_t a = instr.a;
+        std::uint32_t b = instr.b;
+
+        if ( n >= 1 ) {
+            instr.a = slot[a];
+            if ( lastUse[a] == i )  freeSlots.push_back(slot[a]);
+        }
+        if ( n >= 2 ) {
+            instr.b = slot[b];
+            if ( lastUse[b] == i && b != a )  freeSlots.push_back(slot[b]);
+        }
+
+        if ( freeSlots.empty() ) {
+            slot[i] = registers++;
+        }
+        else {
+            slot[i] = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        instr.dst = slot[i];
+    }
+
+    for ( std::uint32_t &result : results ) {
+        result = slot[result];
+    }
+    return registers;
+}
+
+
+// The scalar interpreter loop shared by evalAs() and evalOutputs(), of
+// Tape and TapeView alike
+template <typename T>
+void execute(const TapeView &tape, const std::complex<T> *vars, std::complex<T> *regs) {
+    using C = std::complex<T>;
+
+    for ( const Instruction &instr : tape ) {
+        DIFF_PROFILE_EVAL(profile::opSlot(instr.op, instr.b));
+
+        switch (instr.op) {
+            case OpCode::Const: regs[instr.dst] = C(tape.constants[instr.a]); break;
+            case OpCode::Var:   regs[instr.dst] = vars[instr.a]; break;
+            case OpCode::Add:   regs[instr.dst] = regs[instr.a] + regs[instr.b]; break;
+            case OpCode::Sub:   regs[instr.dst] = regs[instr.a] - regs[instr.b]; break;
+            case OpCode::Mul:   regs[instr.dst] = regs[instr.a] * regs[instr.b]; break;
+            case OpCode::Div:   regs[instr.dst] = regs[instr.a] / regs[instr.b]; break;
+            case OpCode::Pow:   regs[instr.dst] = std::pow(regs[instr.a], regs[instr.b]); break;
+            case OpCode::PowInt: regs[instr.dst] = powInt(regs[instr.a], static_cast<std::int32_t>(instr.b)); break;
+            case OpCode::Call:  regs[instr.dst] = applyFunc(static_cast<FuncId>(instr.b), regs[instr.a]); break;
+            case OpCode::Poly:
+                regs[instr.dst] = horner(tape.constants + polyOffset(instr.b), polyDegree(instr.b), regs[instr.a]);
+                break;
+        }
+    }
+}
+
+// Same loop as execute(), with each instruction applied to a block of points.
+// Register r of point j lives at regs[r * blockSize + j].
+template <typename T>
+void executeBatch(const TapeView &tape, const std::complex<T> *in, std::complex<T> *out, size_t n) {
+    using C = std::complex<T>;
+    constexpr size_t blockSize = Tape::blockSize;
+
+    thread_local std::vector<C> regs;
+    if ( regs.size() < tape.registers * blockSize ) {
+        regs.resize(tape.registers * blockSize);
+    }
+
+    for ( size_t start = 0; start < n; start += blockSize ) {
+        size_t m = std::min(blockSize, n - start);
+        const C *x = in + start;
+
+        for ( const Instruction &instr : tape ) {
+            // Only register operands (operandCount) give block pointers; the
+            // others hold constant or variable indices, exponents or FuncIds
+            const int operands = operandCount(instr.op);
+            C *d = regs.data() + instr.dst * blockSize;
+            const C *a = ( operands >= 1 ) ? regs.data() + instr.a * blockSize : d;
+            const C *b = ( operands >= 2 ) ? regs.data() + instr.b * blockSize : d;
+
+            switch (instr.op) {
+                case OpCode::Const: std::fill(d, d + m, C(tape.constants[instr.a])); break;
+                case OpCode::Var:   std::copy(x, x + m, d); break;
+                case OpCode::Add:   for ( size_t j = 0; j < m; ++j ) d[j] = a[j] + b[j]; break;
+                case OpCode::Sub:   for ( size_t j = 0; j < m; ++j ) d[j] = a[j] - b[j]; break;
+                case OpCode::Mul:   for ( size_t j = 0; j < m; ++j ) d[j] = a[j] * b[j]; break;
+                case OpCode::Div:   for ( size_t j = 0; j < m; ++j ) d[j] = a[j] / b[j]; break;
+                case OpCode::Pow:   for ( size_t j = 0; j < m; ++j ) d[j] = std::pow(a[j], b[j]); break;
+                case OpCode::PowInt: {
+                    // b is the exponent, not a register
+                    auto p = static_cast<std::int32_t>(instr.b);
+                    for ( size_t j = 0; j < m; ++j ) d[j] = powInt(a[j], p);
+                    break;
+                }
+                case OpCode::Call: {
+                    // b is the FuncId, not a register
+                    FuncId id = static_cast<FuncId>(instr.b);
+                    for ( size_t j = 0; j < m; ++j ) d[j] = applyFunc(id, a[j]);
+                    break;
+                }
+                case OpCode::Poly: {
+                    // Independent Horner chains, one per point of the block
+                    const Complex *c = tape.constants + polyOffset(instr.b);
+                    size_t degree = polyDegree(instr.b);
+                    for ( size_t j = 0; j < m; ++j ) d[j] = horner(c, degree, a[j]);
+                    break;
+                }
+            }
+        }
+
+        const C *r = regs.data() + tape.results[0] * blockSize;
+        std::copy(r, r + m, out + start);
+    }
+}
+
+} // namespace
+
+
+
+// Compile a tree (or DAG) into a tape
+Tape Tape::compile(const NodePtr &tree) {
+    return compile(std::vector<NodePtr>{tree});
+}
+
+// Several trees share one builder, so nodes common to them are emitted once
+Tape Tape::compile(const std::vector<NodePtr> &trees) {
+    TapeBuilder builder;
+    std::vector<std::uint32_t> values;
+    for ( const NodePtr &tree : trees ) {
+        values.push_back(builder.emit(tree));
+    }
+
+    Tape tape;
+    tape.code = std::move(builder.code);
+    tape.constants = std::move(builder.constants);
+    tape.variables = builder.variables;
+    tape.registers = allocateRegisters(tape.code, values);
+    tape.results = std::move(values);
+
+    return tape;
+}
+
+// Run the tape once, one register write per instruction
+template <typename T>
+std::complex<T> TapeView::evalAs(const std::complex<T> &x) const {
+    requireSingleVariable();
+
+    // Scratch registers are per thread, so a shared tape can be evaluated concurrently
+    thread_local std::vector<std::complex<T>> regs;
+    if ( regs.size() < registers ) {
+        regs.resize(registers);
+    }
+
+    execute(*this, &x, regs.data());
+
+    return regs[results[0]];
+}
+
+template <typename T>
+void TapeView::evalBatchAs(const std::complex<T> *in, std::complex<T> *out, size_t n) const {
+    requireSingleVariable();
+    executeBatch(*this, in, out, n);
+}
+
+template std::complex<float> TapeView::evalAs<float>(const std::complex<float> &) const;
+template std::complex<double> TapeView::evalAs<double>(const std::complex<double> &) const;
+template std::complex<long double> TapeView::evalAs<long double>(const std::complex<long double> &) const;
+template void TapeView::evalBatchAs<float>(const std::complex<float> *, std::complex<float> *, size_t) const;
+template void TapeView::evalBatchAs<double>(const std::complex<double> *, std::complex<double> *, size_t) const;
+template void TapeView::evalBatchAs<long double>(const std::complex<long double> *, std::complex<long double> *, size_t) const;
+
+Complex TapeView::eval(const Complex &x) const {
+    return evalAs<long double>(x);
+}
+
+void TapeView::requireSingleVariable() const {
+    if ( variables > 1 ) {
+        throw std::runtime_error("Tape reads " + std::to_string(variables) + " variables, evaluate it from a variable vector");
+    }
+}
+
+void TapeView::evalOutputs(const Complex &x, Complex *out) const {
+    requireSingleVariable();
+    evalOutputs(&x, out);
+}
+
+// Same run as eval(), collecting every output register at the end
+void TapeView::evalOutputs(const Complex *vars, Complex *out) const {
+    thread_local std::vector<Complex> regs;
+    if ( regs.size() < registers ) {
+        regs.resize(registers);
+    }
+
+    execute(*this, vars, regs.data());
+
+    for ( size_t i = 0; i < outputCount; ++i ) {
+        out[i] = regs[results[i]];
+    }
+}
+
+void TapeView::evalBatch(const Complex *in, Complex *out, size_t n) const {
+    evalBatchAs<long double>(in, out, n);
+}
+
+
+
+TapeView Tape::view() const {
+    return { code.data(), code.size(), constants.data(), constants.size(), results.data(), results.size(), registers, variables };
+}
+
+template <typename T>
+std::complex<T> Tape::evalAs(const std::complex<T> &x) const {
+    return view().evalAs(x);
+}
+
+template <typename T>
+void Tape::evalBatchAs(const std::complex<T> *in, std::complex<T> *out, size_t n) const {
+    view().evalBatchAs(in, out, n);
+}
+
+template std::complex<float> Tape::evalAs<float>(const std::complex<float> &) const;
+template std::complex<double> Tape::evalAs<double>(const std::complex<double> &) const;
+template std::complex<long double> Tape::evalAs<long double>(const std::complex<long double> &) const;
+template void Tape::evalBatchAs<float>(const std::complex<float> *, std::complex<float> *, size_t) const;
+template void Tape::evalBatchAs<double>(const std::complex<double> *, std::complex<double> *, size_t) const;
+template void Tape::evalBatchAs<long double>(const std::complex<long double> *, std::complex<long double> *, size_t) const;
+
+Complex Tape::eval(const Complex &x) const {
+    return view().eval(x);
+}
+
+void Tape::evalOutputs(const Complex &x, Complex *out) const {
+    view().evalOutputs(x, out);
+}
+
+void Tape::evalOutputs(const Complex *vars, Complex *out) const {
+    view().evalOutputs(vars, out);
+}
+
+void Tape::evalBatch(const Complex *in, Complex *out, size_t n) const {
+    view().evalBatch(in, out, n);
+}
+
+void Tape::requireSingleVariable() const {
+    view().requireSingleVariable();
+}
+
+size_t Tape::memoryBytes() const {
+    return code.capacity() * sizeof(Instruction)
+         + constants.capacity() * sizeof(Complex)
+         + results.capacity() * sizeof(std::uint32_t);
+}
+
+namespace {
+
+// (g o u) for an outer function with g'(u0) = d1 and g''(u0) = d2:
+// (g(u0), d1 u', d2 u'^2 + d1 u'')
+Jet chain(const Complex &g, const Complex &d1, const Complex &d2, const Jet &u) {
+    return { g, d1 * u.f1, d2 * u.f1 * u.f1 + d1 * u.f2 };
+}
+
+// p(u), p'(u), p''(u) for the polynomial c[0..degree], by Horner's rule
+// carrying the derivatives along; p is computed exactly as horner() does
+void hornerJet(const Complex *c, size_t degree, const Complex &u, Complex &p, Complex &d1, Complex &d2) {
+    p = c[degree];
+    d1 = Complex(0.0);
+    d2 = Complex(0.0);
+    for ( size_t k = degree; k-- > 0; ) {
+        d2 = d2 * u + Complex(2.0) * d1;
+        d1 = d1 * u + p;
+        p = p * u + c[k];
+    }
+}
+
+// chain() on boxes
+BoxJet chain(const Box &g, const Box &d1, const Box &d2, const BoxJet &u) {
+    return { g, d1 * u.f1, d2 * interval::sqr(u.f1) + d1 * u.f2 };
+}
+
+} // namespace
+
+// Same dataflow as eval(), on jets instead of values
+Jet Tape::evalJet(const Complex &x) const {
+    requireSingleVariable();
+
+    thread_local std::vector<Jet> regs;
+    if ( regs.size() < registers ) {
+        regs.resize(registers);
+    }
+
+    const Complex zero(0.0), one(1.0), two(2.0);
+
+    for ( const Instruction &instr : code ) {
+        // Const and Var read no register: their a indexes constants or the variable
+        if ( instr.op == OpCode::Const ) {
+            regs[instr.dst] = { constants[instr.a], zero, zero };
+            continue;
+        }
+        if ( instr.op == OpCode::Var ) {
+            regs[instr.dst] = { x, one, zero };
+            continue;
+        }
+
+        // b is a register only for two-operand opcodes (operandCount)
+        const Jet &a = regs[instr.a];
+        const Jet &b = regs[operandCount(instr.op) == 2 ? instr.b : instr.a];
+        Jet r;
+
+        switch (instr.op) {
+            case OpCode::Const:
+            case OpCode::Var:
+                break;
+            case OpCode::Add:
+                r = { a.f + b.f, a.f1 + b.f1, a.f2 + b.f2 };
+                break;
+            case OpCode::Sub:
+                r = { a.f - b.f, a.f1 - b.f1, a.f2 - b.f2 };
+                break;
+            case OpCode::Mul:
+                // (ab)' = a'b + ab',  (ab)'' = a''b + 2a'b' + ab''
+                r = { a.f * b.f, a.f1 * b.f + a.f * b.f1, a.f2 * b.f + two * a.f1 * b.f1 + a.f * b.f2 };
+                break;
+            case OpCode::Div: {
+                // q = a/b:  q' = (a' - q b')/b,  q'' = (a'' - 2q'b' - q b'')/b
+                Complex q = a.f / b.f;
+                Complex q1 = (a.f1 - q * b.f1) / b.f;
+                r = { q, q1, (a.f2 - two * q1 * b.f1 - q * b.f2) / b.f };
+                break;
+            }
+            case OpCode::Pow: {
+                // u^v = exp(w), w = v log u:  p' = p w',  p'' = p (w'' + w'^2)
+                Complex p = std::pow(a.f, b.f);
+                Complex l1 = a.f1 / a.f;
+                Complex l2 = (a.f2 - a.f1 * l1) / a.f;
+                Complex w1 = b.f * l1;
+                Complex w2 = b.f * l2;
+
+                // The log(u) terms only exist for a varying exponent, as in PowerNode::deriv
+                if ( b.f1 != zero || b.f2 != zero ) {
+                    Complex l = std::log(a.f);
+                    w1 += b.f1 * l;
+                    w2 += b.f2 * l + two * b.f1 * l1;
+                }
+                r = { p, p * w1, p * (w2 + w1 * w1) };
+                break;
+            }
+            case OpCode::PowInt: {
+                // g = u^n:  g' = n u^(n-1),  g'' = n (n-1) u^(n-2); vanishing terms
+                // are skipped, so u = 0 gives no 0 * inf
+                auto p = static_cast<std::int32_t>(instr.b);
+                Complex d1 = ( p == 0 ) ? zero : Complex(p) * powInt(a.f, p - 1);
+                Complex d2 = ( p == 0 || p == 1 ) ? zero : Complex(p) * Complex(p - 1) * powInt(a.f, p - 2);
+                r = chain(powInt(a.f, p), d1, d2, a);
+                break;
+            }
+            case OpCode::Call: {
+                Complex g, d1, d2;
+                funcInfo(static_cast<FuncId>(instr.b)).jet(a.f, g, d1, d2);
+                r = chain(g, d1, d2, a);
+                break;
+            }
+            case OpCode::Poly: {
+                Complex g, d1, d2;
+                hornerJet(constants.data() + polyOffset(instr.b), polyDegree(instr.b), a.f, g, d1, d2);
+                r = chain(g, d1, d2, a);
+                break;
+            }
+        }
+
+        regs[instr.dst] = r;
+    }
+
+    return regs[results[0]];
+}
+
+// Same dataflow as evalJet(), on boxes of jets. A constant operand has
+// exactly zero derivative boxes, which keeps the same terms out as evalJet().
+BoxJet Tape::evalBox(const Box &x) const {
+    requireSingleVariable();
+
+    thread_local std::vector<BoxJet> regs;
+    if ( regs.size() < registers ) {
+        regs.resize(registers);
+    }
+
+    const Box zero(Complex(0.0)), one(Complex(1.0)), two(Complex(2.0));
+
+    for ( const Instruction &instr : code ) {
+        // As in evalJet(), only the opcodes with register operands bind them
+        if ( instr.op == OpCode::Const ) {
+            regs[instr.dst] = { Box(constants[instr.a]), zero, zero };
+            continue;
+        }
+        if ( instr.op == OpCode::Var ) {
+            regs[instr.dst] = { x, one, zero };
+            continue;
+        }
+
+        const BoxJet &a = regs[instr.a];
+        const BoxJet &b = regs[operandCount(instr.op) == 2 ? instr.b : instr.a];
+        BoxJet r;
+
+        switch (instr.op) {
+            case OpCode::Const:
+            case OpCode::Var:
+                break;
+            case OpCode::Add:
+                r = { a.f + b.f, a.f1 + b.f1, a.f2 + b.f2 };
+                break;
+            case OpCode::Sub:
+                r = { a.f - b.f, a.f1 - b.f1, a.f2 - b.f2 };
+                break;
+            case OpCode::Mul:
+                r = { a.f * b.f, a.f1 * b.f + a.f * b.f1, a.f2 * b.f + two * a.f1 * b.f1 + a.f * b.f2 };
+                break;
+            case OpCode::Div: {
+                Box q = a.f / b.f;
+                Box q1 = (a.f1 - q * b.f1) / b.f;
+                r = { q, q1, (a.f2 - two * q1 * b.f1 - q * b.f2) / b.f };
+                break;
+            }
+            case OpCode::Pow: {
+                Box p = interval::pow(a.f, b.f);
+                Box l1 = a.f1 / a.f;
+                Box l2 = (a.f2 - a.f1 * l1) / a.f;
+                Box w1 = b.f * l1;
+                Box w2 = b.f * l2;
+
+                if ( !b.f1.isZero() || !b.f2.isZero() ) {
+                    Box l = interval::log(a.f);
+                    w1 = w1 + b.f1 * l;
+                    w2 = w2 + b.f2 * l + two * b.f1 * l1;
+                }
+                r = { p, p * w1, p * (w2 + interval::sqr(w1)) };
+                break;
+            }
+            case OpCode::PowInt: {
+                auto p = static_cast<std::int32_t>(instr.b);
+                Box d1 = ( p == 0 ) ? zero : Box(Complex(p)) * interval::powInt(a.f, p - 1);
+                Box d2 = ( p == 0 || p == 1 ) ? zero : Box(Complex(p)) * Box(Complex(p - 1)) * interval::powInt(a.f, p - 2);
+                r = chain(interval::powInt(a.f, p), d1, d2, a);
+                break;
+            }
+            case OpCode::Call: {
+                Box g, d1, d2;
+                funcInfo(static_cast<FuncId>(instr.b)).box(a.f, g, d1, d2);
+                r = chain(g, d1, d2, a);
+                break;
+            }
+            case OpCode::Poly: {
+                // hornerJet() in box arithmetic
+                const Complex *c = constants.data() + polyOffset(instr.b);
+                Box g(c[polyDegree(instr.b)]), d1 = zero, d2 = zero;
+                for ( size_t k = polyDegree(instr.b); k-- > 0; ) {
+                    d2 = d2 * a.f + two * d1;
+                    d1 = d1 * a.f + g;
+                    g = g * a.f + Box(c[k]);
+                }
+                r = chain(g, d1, d2, a);
+                break;
+            }
+        }
+
+        regs[instr.dst] = r;
+    }
+
+    return regs[results[0]];
+}
+
+// Same dataflow as evalJet(), on series of order+1 coefficients.
+// Register r holds its series at regs[r * n .. r * n + n - 1].
+void Tape::evalTaylor(const Complex &x, size_t order, Complex *coeffs) const {
+    requireSingleVariable();
+    const size_t n = order + 1;
+
+    thread_local std::vector<Complex> regs, result, product;
+    if ( regs.size() < registers * n ) {
+        regs.resize(registers * n);
+    }
+    result.resize(n);
+    product.resize(n);
+
+    for ( const Instruction &instr : code ) {
+        // As in executeBatch(), only register operands give series pointers
+        const int operands = operandCount(instr.op);
+        const Complex *a = ( operands >= 1 ) ? regs.data() + instr.a * n : nullptr;
+        const Complex *b = ( operands >= 2 ) ? regs.data() + instr.b * n : nullptr;
+        Complex *r = result.data();
+
+        // dst may share a slot with an operand, so results go through `result`
+        switch (instr.op) {
+            case OpCode::Const:
+                std::fill(r, r + n, Complex(0.0));
+                r[0] = constants[instr.a];
+                break;
+            case OpCode::Var:
+                std::fill(r, r + n, Complex(0.0));
+                r[0] = x;
+                if ( n > 1 )  r[1] = Complex(1.0);
+                break;
+            case OpCode::Add:   for ( size_t k = 0; k < n; ++k ) r[k] = a[k] + b[k]; break;
+            case OpCode::Sub:   for ( size_t k = 0; k < n; ++k ) r[k] = a[k] - b[k]; break;
+            case OpCode::Mul:   series::mul(a, b, r, n); break;
+            case OpCode::Div:   series::div(a, b, r, n); break;
+            case OpCode::Pow:   series::pow(a, b, r, n); break;
+            case OpCode::PowInt: series::powInt(a, static_cast<std::int32_t>(instr.b), r, n); break;
+            case OpCode::Call:  funcInfo(static_cast<FuncId>(instr.b)).taylor(a, r, n); break;
+            case OpCode::Poly: {
+                // Horner's rule on series: r = r * a + c[k]
+                const Complex *c = constants.data() + polyOffset(instr.b);
+                std::fill(r, r + n, Complex(0.0));
+                r[0] = c[polyDegree(instr.b)];
+                for ( size_t k = polyDegree(instr.b); k-- > 0; ) {
+                    series::mul(r, a, product.data(), n);
+                    std::copy(product.begin(), product.end(), r);
+                    r[0] += c[k];
+                }
+                break;
+            }
+        }
+
+        std::copy(r, r + n, regs.data() + instr.dst * n);
+    }
+
+    const Complex *f = regs.data() + results[0] * n;
+    std::copy(f, f + n, coeffs);
+}
+
+namespace {
+
+// One function over a column of lanes: simd kernels where they exist,
+// std::complex<double> per lane for the rest
+void callSoA(FuncId id, const double *ar, const double *ai, double *dr, double *di, size_t m) {
+    switch (id) {
+        case FuncId::Sin:   simd::sin(ar, ai, dr, di, m); return;
+        case FuncId::Cos:   simd::cos(ar, ai, dr, di, m); return;
+        case FuncId::Tan:   simd::tan(ar, ai, dr, di, m); return;
+        case FuncId::Cot:   simd::cot(ar, ai, dr, di, m); return;
+        case FuncId::Log:   simd::log(ar, ai, dr, di, m); return;
+        default:
+            for ( size_t j = 0; j < m; ++j ) {
+                std::complex<double> r = applyFunc(id, std::complex<double>(ar[j], ai[j]));
+                dr[j] = r.real();
+                di[j] = r.imag();
+            }
+    }
+}
+
+} // namespace
+
+// Double-precision batch on split real/imaginary register files:
+// re[r * blockSize + j], im[r * blockSize + j], one simd kernel per instruction
+void Tape::evalBatchSoA(const double *inRe, const double *inIm, double *outRe, double *outIm, size_t n) const {
+    requireSingleVariable();
+
+    thread_local std::vector<double> re, im;
+    if ( re.size() < registers * blockSize ) {
+        re.resize(registers * blockSize);
+        im.resize(registers * blockSize);
+    }
+
+    for ( size_t start = 0; start < n; start += blockSize ) {
+        size_t m = std::min(blockSize, n - start);
+
+        for ( const Instruction &instr : code ) {
+            // As in executeBatch(), only register operands give block pointers
+            const int operands = operandCount(instr.op);
+            const size_t sa = ( operands >= 1 ) ? instr.a : instr.dst;
+            const size_t sb = ( operands >= 2 ) ? instr.b : instr.dst;
+            double *dr = re.data() + instr.dst * blockSize, *di = im.data() + instr.dst * blockSize;
+            const double *ar = re.data() + sa * blockSize, *ai = im.data() + sa * blockSize;
+            const double *br = re.data() + sb * blockSize, *bi = im.data() + sb * blockSize;
+
+            switch (instr.op) {
+                case OpCode::Const:
+                    std::fill(dr, dr + m, static_cast<double>(constants[instr.a].real()));
+                    std::fill(di, di + m, static_cast<double>(constants[instr.a].imag()));
+                    break;
+                case OpCode::Var:
+                    std::copy(inRe + start, inRe + start + m, dr);
+                    std::copy(inIm + start, inIm + start + m, di);
+                    break;
+                case OpCode::Add:   simd::add(ar, ai, br, bi, dr, di, m); break;
+                case OpCode::Sub:   simd::sub(ar, ai, br, bi, dr, di, m); break;
+                case OpCode::Mul:   simd::mul(ar, ai, br, bi, dr, di, m); break;
+                case OpCode::Div:   simd::div(ar, ai, br, bi, dr, di, m); break;
+                case OpCode::Pow:   simd::pow(ar, ai, br, bi, dr, di, m); break;
+                case OpCode::PowInt: simd::powInt(ar, ai, static_cast<std::int32_t>(instr.b), dr, di, m); break;
+                case OpCode::Call:  callSoA(static_cast<FuncId>(instr.b), ar, ai, dr, di, m); break;
+                case OpCode::Poly: {
+                    size_t degree = polyDegree(instr.b);
+                    const Complex *c = constants.data() + polyOffset(instr.b);
+                    double cr[256], ci[256];
+                    for ( size_t k = 0; k <= degree; ++k ) {
+                        cr[k] = static_cast<double>(c[k].real());
+                        ci[k] = static_cast<double>(c[k].imag());
+                    }
+                    simd::horner(cr, ci, degree, ar, ai, dr, di, m);
+                    break;
+                }
+            }
+        }
+
+        const double *rr = re.data() + results[0] * blockSize, *ri = im.data() + results[0] * blockSize;
+        std::copy(rr, rr + m, outRe + start);
+        std::copy(ri, ri + m, outIm + start);
+    }
+}
@@ -0,0 +1,128 @@
+// src/thread_pool.cpp
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "thread_pool.hpp"
+
+
+
+ThreadPool::ThreadPool(size_t threads) {
+    if ( threads == 0 ) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for ( size_t i = 0; i < threads; ++i ) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+
+    for ( std::thread &worker : workers ) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while ( true ) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if ( tasks.empty() ) {
+                return;     // stopping, and the queue is drained
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+
+namespace {
+
+// State of one parallelFor() call, shared with helper tasks that may start
+// only after the caller has already returned
+struct ParallelRange {
+    std::function<void(size_t, size_t)> body;
+    size_t n;
+    size_t chunk;
+    size_t chunks;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    // Claim and run chunks until none are left
+    void work() {
+        size_t index;
+        while ( (index = next.fetch_add(1)) < chunks ) {
+            size_t begin = index * chunk;
+            size_t end = std::min(n, begin + chunk);
+
+            try {
+                body(begin, end);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if ( !error ) error = std::current_exception();
+            }
+
+            if ( finished.fetch_add(1) + 1 == chunks ) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+
+void ThreadPool::parallelFor(size_t n, size_t chunk, const std::function<void(size_t, size_t)> &body) {
+    if ( n == 0 ) {
+        return;
+    }
+    chunk = std::max<size_t>(chunk, 1);
+
+    auto range = std::make_shared<ParallelRange>();
+    range -> body = body;
+    range -> n = n;
+    range -> chunk = chunk;
+    range -> chunks = (n + chunk - 1) / chunk;
+
+    // One helper per worker at most; the calling thread works too, so this
+    // cannot deadlock when called from inside a pool task
+    size_t helpers = std::min(workers.size(), range -> chunks - 1);
+    for ( size_t i = 0; i < helpers; ++i ) {
+        submit([range] { range -> work(); });
+    }
+    range -> work();
+
+    std::unique_lock<std::mutex> lock(range -> mutex);
+    range -> done.wait(lock, [&] { return range -> finished.load() == range -> chunks; });
+
+    if ( range -> error ) {
+        std::rethrow_exception(range -> error);
+    }
+}
@@ -0,0 +1,85 @@
+// src/tokenizer.cpp
+#include <cctype>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "tokenizer.hpp"
+
+
+
+namespace {
+
+bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }
+bool isAlpha(char c) { return std::isalpha(static_cast<unsigned char>(c)) != 0; }
+bool isAlnum(char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_'; }
+bool isSpace(char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }
+
+} // namespace
+
+
+
+std::vector<Token> tokenize(std::string_view input) {
+    std::vector<Token> tokens;
+    tokens.reserve(input.size() + 1);     // Every token but End spans at least one character
+
+    tokenizeRange(input, 0, input.size(), tokens);
+
+    tokens.push_back({ TokenKind::End, input.substr(input.size()), input.size() });
+    return tokens;
+}
+
+void tokenizeRange(std::string_view whole, size_t begin, size_t end, std::vector<Token> &tokens) {
+    std::string_view input = whole.substr(0, end);
+
+    size_t pos = begin;
+    while ( pos < input.size() ) {
+        char c = input[pos];
+
+        if ( isSpace(c) ) {
+            ++pos;
+            continue;
+        }
+
+        size_t start = pos;
+
+        if ( isDigit(c) ) {
+            while ( pos < input.size() && isDigit(input[pos]) )  ++pos;
+            if ( pos < input.size() && input[pos] == '.' ) {
+                ++pos;
+                while ( pos < input.size() && isDigit(input[pos]) )  ++pos;
+            }
+
+            Token token{ TokenKind::Number, input.substr(start, pos - start), start };
+            auto [end, error] = std::from_chars(input.data() + start, input.data() + pos, token.value);
+            if ( error != std::errc() || end != input.data() + pos ) {
+                throw ParseError("Invalid number: " + std::string(token.text), start);
+            }
+            tokens.push_back(token);
+            continue;
+        }
+
+        if ( isAlpha(c) ) {
+            while ( pos < input.size() && isAlnum(input[pos]) )  ++pos;
+            tokens.push_back({ TokenKind::Ident, input.substr(start, pos - start), start });
+            continue;
+        }
+
+        TokenKind kind;
+        switch (c) {
+            case '+': kind = TokenKind::Plus; break;
+            case '-': kind = TokenKind::Minus; break;
+            case '*': kind = TokenKind::Star; break;
+            case '/': kind = TokenKind::Slash; break;
+            case '^': kind = TokenKind::Caret; break;
+            case '(': kind = TokenKind::LParen; break;
+            case ')': kind = TokenKind::RParen; break;
+            default:
+                throw ParseError(std::string("Unexpected char: ") + c, pos);
+        }
+        tokens.push_back({ kind, input.substr(pos, 1), pos });
+        ++pos;
+    }
+}
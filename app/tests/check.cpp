@@ -0,0 +1,426 @@
+// tests/check.cpp
+//
+// Self-checks of the evaluators against each other: interval bounds
+// contain the point values, catalogs round-trip and reject corrupt files,
+// incremental updates match fresh builds, adjoint gradients match the
+// symbolic ones, plus regressions of specific inputs. Built with
+// _GLIBCXX_ASSERTIONS, so an out-of-range container access aborts.
+//
+//   make check
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "adjoint.hpp"
+#include "cache.hpp"
+#include "catalog.hpp"
+#include "differentiator.hpp"
+#include "expression.hpp"
+#include "gradient.hpp"
+#include "incremental.hpp"
+#include "interval.hpp"
+#include "parser.hpp"
+#include "tape.hpp"
+#include "tokenizer.hpp"
+
+
+
+namespace {
+
+// The test expressions and points from main.cpp
+const std::vector<std::string> corpus = {
+    "2 * x^3",
+    "sin(x)",
+    "x^2 + 3*x",
+    "log(x)",
+    "x^x",
+    "x^2 * cos(x) + log(x) * cos(x - 1)",
+    "22.5+log(sin(77.6)^(50.2^42.1)/(x/x)-(81.9/x^x*58.8)*(18*57.2^x-x^x+81.9*x^5.2*x^62)^x)",
+    "x^93.2 - x*cos( x^(x^x / x^28.8 / x) + x - x^60.3 * 0.5^x / cos(48.6^x + 24.9^80.3 / 60 - x*15.9))*44.4",
+    "x^88.3 / x^81.8 / x",
+    "x+cot(89.4*x^(x/62.5^x*36.5^52.5-63/x^37+27.3)+x/x)+99.5/x/(x+x^69.1*(8.4^x*x^37.6/x)/x^sin(57.7^x*x^x+x-x))^x"
+};
+
+const std::vector<Complex> points = {
+    { 2, 2 }, { 1.63, -2.11 }, { 1, 0 }, { -32, 32 }, { -4.6, -9.47 }, { 5.89, 6.23 }, { -9.17, 2.23 }, { -1.73, 3 }
+};
+
+// More constants than registers, and integer powers: operands that are indices, not registers
+const std::string manyConstants = "2.5*sin(x)+3.5*cos(x)+4.5*tan(x)+5.5*exp(x)+6.5*log(x)+7.5*sinh(x)+8.5*cosh(x)";
+
+const std::uint32_t seed = 20240601;
+
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+    if ( !ok ) {
+        ++failures;
+        std::cout << "  FAIL " << what << "\n";
+    }
+}
+
+// Equal bit for bit, NaNs included
+bool same(const Complex &a, const Complex &b) {
+    bool nan = std::isnan(a.real()) || std::isnan(a.imag());
+    bool bnan = std::isnan(b.real()) || std::isnan(b.imag());
+    return nan ? bnan : ( !bnan && a == b && std::signbit(a.imag()) == std::signbit(b.imag()) );
+}
+
+bool close(const Complex &a, const Complex &b, long double tolerance) {
+    if ( !std::isfinite(std::abs(a)) || !std::isfinite(std::abs(b)) ) {
+        return same(a, b) || !std::isfinite(std::abs(a)) == !std::isfinite(std::abs(b));
+    }
+    return std::abs(a - b) <= tolerance * std::max<long double>(1.0L, std::abs(b));
+}
+
+std::string str(const Complex &z) {
+    std::ostringstream out;
+    out << z;
+    return out.str();
+}
+
+// Non-finite point values are outside any bound and are not checked
+bool inBound(const Interval &bound, long double value) {
+    return !std::isfinite(value) || ( bound.lo <= value && value <= bound.hi );
+}
+
+bool inBound(const Box &bound, const Complex &z) {
+    return inBound(bound.re, z.real()) && inBound(bound.im, z.imag());
+}
+
+
+
+void boxContainment() {
+    const std::vector<std::string> expressions = {
+        "2 * x^3", "sin(x)", "x^2 + 3*x", "log(x)", "x^x", "x^2 * cos(x) + log(x) * cos(x - 1)",
+        "tan(x)/cot(x+1)", "sqrt(x)*exp(x)", "sinh(x)+cosh(2*x)-tanh(x)", "asin(x)+acos(x/2)", "atan(x)*x",
+        "x^2.5+1/x^3", "(x+1)/(x^2+4)", "exp(sin(x))*log(x^2+1)", "x^(sin(x))", "3*x^2+2*x+1", manyConstants
+    };
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> corner(-4.0, 4.0), width(0.0, 0.5), unit(0.0, 1.0);
+
+    for ( const std::string &mathExpr : expressions ) {
+        Expression expr(mathExpr);
+
+        for ( int k = 0; k < 60; ++k ) {
+            long double re = corner(rng), im = corner(rng);
+            long double dr = ( k % 5 == 0 ) ? 0.0 : width(rng), di = ( k % 5 == 0 ) ? 0.0 : width(rng);
+            BoxJet bound = expr.bound(Box({ re, re + dr }, { im, im + di }));
+
+            for ( int s = 0; s < 8; ++s ) {
+                Complex z(re + dr * unit(rng), im + di * unit(rng));
+                const Box *boxes[3] = { &bound.f, &bound.f1, &bound.f2 };
+                for ( int order = 0; order < 3; ++order ) {
+                    check(inBound(*boxes[order], expr.eval(order, z)),
+                          mathExpr + ": order " + std::to_string(order) + " at " + str(z) + " outside its bound");
+                }
+            }
+        }
+    }
+}
+
+void catalogRoundTrip() {
+    const char *dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/differentiate-check-" + std::to_string(::getpid()) + ".cat";
+
+    std::vector<std::string> expressions = corpus;
+    expressions.push_back(manyConstants);
+    expressions.push_back("(2*x^3+x-1)/(x^2*3+x*2-5)");
+    Catalog::write(path, expressions);
+
+    {
+        Catalog catalog(path);
+        check(catalog.size() == expressions.size(), "catalog size");
+
+        for ( size_t i = 0; i < expressions.size(); ++i ) {
+            Expression expr(expressions[i]);
+            const size_t *found = catalog.find(expressions[i]);
+            check(found && *found == i, "catalog find " + expressions[i]);
+
+            for ( int order = 0; order < 3; ++order ) {
+                TapeView tape = catalog.tape(i, order);
+                std::vector<Complex> batch(points.size());
+                tape.evalBatch(points.data(), batch.data(), points.size());
+
+                for ( size_t k = 0; k < points.size(); ++k ) {
+                    Complex value = expr.tape(order).eval(points[k]);
+                    check(same(tape.eval(points[k]), value) && same(batch[k], value),
+                          "catalog entry " + std::to_string(i) + " order " + std::to_string(order) + " at " + str(points[k]));
+                }
+            }
+        }
+    }
+
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Header: magic[8], version, entry count, two sizes (uint32), file bytes (uint64);
+    // then the entries, each starting with text offset and size (uint64) and
+    // the tape of f, whose first field is the offset of its code
+    auto patched = [&](size_t offset, std::uint32_t value) {
+        std::string copy = bytes;
+        std::memcpy(&copy[offset], &value, sizeof(value));
+        return copy;
+    };
+    std::uint64_t codeOffset;
+    std::memcpy(&codeOffset, &bytes[48], sizeof(codeOffset));
+
+    const std::vector<std::pair<std::string, std::string>> corrupt = {
+        { "empty", "" },
+        { "truncated header", bytes.substr(0, 20) },
+        { "truncated", bytes.substr(0, bytes.size() / 2) },
+        { "bad magic", patched(0, 0x21212121u) },
+        { "other version", patched(8, Catalog::version + 1) },
+        { "entry count", patched(12, 1u << 30) },
+        { "register out of range", patched(codeOffset + offsetof(Instruction, dst), 0xffffffffu) },
+        { "operand out of range", patched(codeOffset + offsetof(Instruction, a), 0xffffffffu) },
+    };
+
+    for ( const auto &file : corrupt ) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << file.second;
+        }
+        bool rejected = false;
+        try {
+            Catalog catalog(path);
+        }
+        catch (const std::runtime_error &) {
+            rejected = true;
+        }
+        check(rejected, "corrupt catalog accepted: " + file.first);
+    }
+
+    std::remove(path.c_str());
+}
+
+void incrementalMatchesFresh() {
+    std::string mathExpr;
+    for ( int k = 0; k < 120; ++k ) {
+        mathExpr += ( k ? " + " : "" ) + std::string("sin(") + std::to_string(k % 17 + 1) + "*x^2 + cos(x/"
+                  + std::to_string(k % 5 + 1) + "))*log(x+" + std::to_string(k) + ")";
+    }
+
+    std::mt19937 rng(seed);
+    const std::vector<Complex> at = { { 0.7, 0.2 }, { 1.3, -0.4 } };
+    IncrementalDifferentiator incremental;
+    incremental.update(mathExpr);
+
+    for ( int edit = 0; edit < 24; ++edit ) {
+        size_t pos;
+        switch (edit % 4) {
+            case 0:
+                do { pos = rng() % mathExpr.size(); } while ( !std::isdigit(static_cast<unsigned char>(mathExpr[pos])) );
+                mathExpr[pos] = "123456789"[rng() % 9];
+                break;
+            case 1:
+                do { pos = rng() % mathExpr.size(); } while ( mathExpr[pos] != 'x' );
+                mathExpr.replace(pos, 1, "(x+1)");
+                break;
+            case 2:
+                mathExpr += " + tan(x^2)";
+                break;
+            default: {
+                // A syntax error is reported, as by a full parse, and changes nothing
+                do { pos = rng() % mathExpr.size(); } while ( mathExpr[pos] != '(' );
+                std::string broken = mathExpr;
+                broken.insert(pos + 1, ")");
+                bool reported = false;
+                try {
+                    incremental.update(broken);
+                }
+                catch (const ParseError &) {
+                    reported = true;
+                }
+                check(reported, "incremental update accepted a syntax error");
+                break;
+            }
+        }
+
+        auto [f, f1, f2] = incremental.update(mathExpr);
+        IncrementalDifferentiator fresh;
+        auto [g, g1, g2] = fresh.update(mathExpr);
+        auto [d, d1, d2] = differentiate(mathExpr);
+
+        for ( const Complex &z : at ) {
+            Complex got[3] = { f(z), f1(z), f2(z) };
+            Complex rebuilt[3] = { g(z), g1(z), g2(z) };
+            Complex reference[3] = { d(z), d1(z), d2(z) };
+            for ( int order = 0; order < 3; ++order ) {
+                check(same(got[order], rebuilt[order]), "incremental edit " + std::to_string(edit) + " order "
+                      + std::to_string(order) + ": " + str(got[order]) + " vs fresh " + str(rebuilt[order]));
+                check(close(got[order], reference[order], 1e-9L), "incremental edit " + std::to_string(edit) + " order "
+                      + std::to_string(order) + ": " + str(got[order]) + " vs differentiate() " + str(reference[order]));
+            }
+        }
+    }
+
+    // Edits that only revisit known subexpressions leave the kept state as it is
+    const std::string prefix = "sin(3*x^2)*log(x+1) + cos(x/2)/(x+3) + (x+2)+";
+    IncrementalDifferentiator repeated;
+    repeated.update(prefix + "1");
+    repeated.update(prefix + "2");
+    size_t nodes = repeated.stats().retained;
+
+    for ( int edit = 0; edit < 2000; ++edit ) {
+        repeated.update(prefix + ( edit % 2 ? "2" : "1" ));
+        const IncrementalStats &stats = repeated.stats();
+        if ( stats.rebuilt || stats.newNodes || stats.retained != nodes ) {
+            check(false, "repeated edit " + std::to_string(edit) + ": retained " + std::to_string(stats.retained)
+                  + " after " + std::to_string(nodes) + ", new nodes " + std::to_string(stats.newNodes));
+            break;
+        }
+    }
+}
+
+void adjointMatchesSymbolic() {
+    const std::vector<std::string> expressions = {
+        "x*y + sin(x*y)/z", "exp(a1)^b_2 + a1^3*log(b_2) - c/(a1*b_2)", "sqrt(u^2+v^2+w^2) * cos(u-v)^2 / (1 + w^0)",
+        "tan(p)*cot(q^2) + p^q + 2^q", "3", "x - y - (x*y - 2)", "atan(x/y)+asin(x/9)*acos(y/7)+tanh(x)-cosh(y)*sinh(x)",
+        "x^9", "(x^2+y)^5 - 3*x^2*y + 2", manyConstants
+    };
+
+    for ( const std::string &mathExpr : expressions ) {
+        MultiExpression expr(mathExpr);
+        size_t n = expr.variableCount();
+        std::vector<Complex> vars(n), symbolic(n), adjoint(n);
+        for ( size_t i = 0; i < n; ++i ) {
+            vars[i] = Complex(0.3 + 0.4 * i, 0.1 * i + 0.05);
+        }
+
+        Complex f = expr.gradient(vars.data(), symbolic.data());
+        AdjointTape tape(expr.tape());
+        check(close(tape.gradient(vars.data(), adjoint.data()), f, 1e-15L), mathExpr + ": adjoint f");
+
+        for ( size_t i = 0; i < n; ++i ) {
+            check(close(adjoint[i], symbolic[i], 1e-14L), mathExpr + ": adjoint partial " + std::to_string(i)
+                  + " " + str(adjoint[i]) + " vs " + str(symbolic[i]));
+        }
+    }
+}
+
+// Inputs that once went wrong
+void regressions() {
+    // Every tape evaluator on operands that are constant indices, exponents or FuncIds
+    for ( const std::string &mathExpr : { std::string("x^9"), std::string("1/x^7 + x^(0-3)"), manyConstants } ) {
+        Expression expr(mathExpr);
+        Tape tape = Tape::compile(Parser(mathExpr).parse());
+        Complex z(1.1, 0.1);
+
+        Jet jet = tape.evalJet(z);
+        check(close(jet.f1, expr.eval(1, z), 1e-15L), mathExpr + ": evalJet f'");
+
+        Complex coeffs[4];
+        tape.evalTaylor(z, 3, coeffs);
+        check(close(coeffs[1], expr.eval(1, z), 1e-15L), mathExpr + ": evalTaylor f'");
+
+        std::vector<Complex> in(Tape::blockSize + 3, z), out(in.size());
+        tape.evalBatch(in.data(), out.data(), in.size());
+        check(close(out.back(), expr.eval(0, z), 1e-15L), mathExpr + ": evalBatch");
+
+        std::vector<double> re(in.size(), 1.1), im(in.size(), 0.1), outRe(in.size()), outIm(in.size());
+        tape.evalBatchSoA(re.data(), im.data(), outRe.data(), outIm.data(), in.size());
+        check(close(Complex(outRe.back(), outIm.back()), expr.eval(0, z), 1e-12L), mathExpr + ": evalBatchSoA");
+    }
+
+    // A folded (0, -0) must not become +0: Im f stays on its side of the cut of log
+    {
+        DiffOptions plain;
+        plain.simplify = false;
+        Expression simplified(corpus[6]), unsimplified(corpus[6], plain);
+        Complex one(1.0);
+        check(same(simplified.eval(0, one), unsimplified.eval(0, one)),
+              "signed zero: " + str(simplified.eval(0, one)) + " vs " + str(unsimplified.eval(0, one)));
+    }
+
+    // Factored polynomials stay factored, so values near their roots keep their accuracy
+    {
+        const std::string mathExpr = "(x-1)*(x-1)*(x-1)*(x-1)*(x-1)*3/7/11/13/17";
+        DiffOptions plain;
+        plain.polynomials = false;
+        Expression collected(mathExpr), uncollected(mathExpr, plain);
+        Complex z(1.0L + 1e-7L);
+        for ( int order = 0; order < 3; ++order ) {
+            // Relative: the values are tiny (1.76e-39 for f)
+            Complex a = collected.eval(order, z), b = uncollected.eval(order, z);
+            check(std::abs(a - b) <= 1e-9L * std::abs(b),
+                  "factored polynomial order " + std::to_string(order) + ": " + str(a) + " vs " + str(b));
+        }
+    }
+
+    // Exponents near INT32_MIN: the second derivative's exponent n - 2 must not wrap
+    {
+        const std::string mathExpr = "x^(1-2147483648)";
+        Expression expr(mathExpr);
+        Complex z(0.9999999L);
+        long double n = 1.0L - 2147483648.0L;
+        Complex expected = n * (n - 1) * std::pow(z, n - 2);
+        Complex a = expr.eval(2, z), b = Tape::compile(Parser(mathExpr).parse()).evalJet(z).f2;
+        check(std::abs(a - expected) <= 1e-9L * std::abs(expected), mathExpr + " f'': " + str(a) + " vs " + str(expected));
+        check(std::abs(b - expected) <= 1e-9L * std::abs(expected), mathExpr + " evalJet f'': " + str(b) + " vs " + str(expected));
+    }
+
+    // Orders built after an expression was cached are charged to it on the next hit
+    {
+        ExpressionCache cache(16, 1 << 24);
+        std::shared_ptr<const Expression> expr = cache.get(corpus.back());
+        expr -> eval(2, points[0]);
+        cache.get(corpus.back());
+        check(cache.stats().bytes == expr -> memoryBytes(), "cache bytes " + std::to_string(cache.stats().bytes)
+              + " vs " + std::to_string(expr -> memoryBytes()));
+    }
+}
+
+} // namespace
+
+
+
+int main() {
+    const std::vector<std::pair<const char *, std::function<void()>>> suites = {
+        { "box containment", boxContainment },
+        { "catalog round trip", catalogRoundTrip },
+        { "incremental vs fresh", incrementalMatchesFresh },
+        { "adjoint vs symbolic gradient", adjointMatchesSymbolic },
+        { "regressions", regressions },
+    };
+
+    for ( const auto &suite : suites ) {
+        int before = failures;
+        try {
+            suite.second();
+        }
+        catch (const std::exception &e) {
+            check(false, std::string("exception: ") + e.what());
+        }
+        std::cout << ( failures == before ? "ok   " : "FAIL " ) << suite.first << "\n";
+    }
+
+    if ( failures ) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "all checks passed\n";
+    return 0;
+}